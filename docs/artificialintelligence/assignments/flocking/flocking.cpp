@@ -1,323 +1,252 @@
 #include <iostream>
-#include <iomanip>
+#include <cstdio>
 #include <vector>
 #include <utility>
-#include <cmath>
 #include <string>
+#include <memory>
+#include <cstdlib>
 
-using namespace std;
-
-struct Vector2 {
-  double x=0, y=0;
-  Vector2() : x(0), y(0){};
-  Vector2(double x, double y) : x(x), y(y){};
-  Vector2(const Vector2& v) = default;
-
-  // unary operations
-  Vector2 operator-() const { return {-x, -y}; }
-  Vector2 operator+() const { return {x, y}; }
+#include "flocking_behaviours.h"
+#include "flocking_engine.h"
+#include "flocking_integrator.h"
+#include "flocking_stream.h"
+#include "flocking_trace.h"
+#include "flocking_vector.h"
 
-  // binary operations
-  Vector2 operator-(const Vector2& rhs) const { return {x - rhs.x, y - rhs.y}; }
-  Vector2 operator+(const Vector2& rhs) const { return {x + rhs.x, y + rhs.y}; }
-  Vector2 operator*(const double& rhs) const { return {x * rhs, y * rhs}; }
-  friend Vector2 operator*(const double& lhs, const Vector2& rhs) { return {lhs * rhs.x, lhs * rhs.y}; }
-  Vector2 operator/(const double& rhs) const { return {x / rhs, y / rhs}; }
-  Vector2 operator/(const Vector2& rhs) const { return {x / rhs.x, y / rhs.y}; }
-  bool operator!=(const Vector2& rhs) const { return (*this - rhs).sqrMagnitude() >= 1.0e-6; };
-  bool operator==(const Vector2& rhs) const { return (*this - rhs).sqrMagnitude() < 1.0e-6; };
+using namespace std;
 
-  // assignment operation
-  Vector2& operator=(Vector2 const& rhs) = default;
-  Vector2& operator=(Vector2&& rhs) = default;
+// command line options, the defaults keep the original brute-force loops and one Euler step per
+// tick; see EngineOptions for the engines and IntegratorOptions for the substeps
+struct FlockingOptions : flocking::EngineOptions, flocking::IntegratorOptions {
+  // binary file the force components of every boid are written to at the end, none when empty;
+  // the trace only records the first traceLimit boid ticks, in a buffer allocated up front
+  string tracePath;
+  size_t traceLimit = size_t(1) << 18;
+  // binary input and output instead of text, see flocking_stream.h
+  bool binaryInput = false, binaryOutput = false;
+  // bytes per number in the binary frames written, 4 for float or 8 for double
+  uint32_t framePrecision = 8;
+  // convert a text input to a binary one, or any binary file to text, and exit
+  bool toBinary = false, toText = false;
+  // approx engine: report how far its forces are from the exact ones at the end
+  bool approximationError = false;
+};
 
-  // compound assignment operations
-  Vector2& operator+=(const Vector2& rhs) {
-    x += rhs.x;
-    y += rhs.y;
-    return *this;
+bool parseOptions(int argc, char* argv[], FlockingOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (arg.rfind("--engine=", 0) == 0)
+      options.engine = arg.substr(9);
+    else if (arg.rfind("--isa=", 0) == 0) {
+      if (!flocking::parseIsa(arg.substr(6), options.isa)) {
+        cerr << "unknown instruction set: " << arg.substr(6) << endl;
+        return false;
+      }
+    } else if (arg == "--precision=float")
+      options.singlePrecision = true;
+    else if (arg == "--precision=double")
+      options.singlePrecision = false;
+    else if (arg.rfind("--threads=", 0) == 0)
+      options.threads = atoi(arg.substr(10).c_str());
+    else if (arg.rfind("--trace=", 0) == 0)
+      options.tracePath = arg.substr(8);
+    else if (arg.rfind("--trace-limit=", 0) == 0)
+      options.traceLimit = strtoull(arg.substr(14).c_str(), nullptr, 10);
+    else if (arg == "--input-format=text" || arg == "--input-format=binary")
+      options.binaryInput = arg == "--input-format=binary";
+    else if (arg == "--output-format=text" || arg == "--output-format=binary")
+      options.binaryOutput = arg == "--output-format=binary";
+    else if (arg == "--frame-precision=float" || arg == "--frame-precision=double")
+      options.framePrecision = arg == "--frame-precision=float" ? 4 : 8;
+    else if (arg.rfind("--cells-per-radius=", 0) == 0)
+      options.cellsPerRadius = atoi(arg.substr(19).c_str());
+    else if (arg.rfind("--integrator=", 0) == 0) {
+      if (!flocking::parseScheme(arg.substr(13), options.scheme)) {
+        cerr << "unknown integrator: " << arg.substr(13) << endl;
+        return false;
+      }
+    } else if (arg.rfind("--max-step=", 0) == 0)
+      options.maxStep = atof(arg.substr(11).c_str());
+    else if (arg.rfind("--max-substeps=", 0) == 0)
+      options.maxSubsteps = atoi(arg.substr(15).c_str());
+    else if (arg.rfind("--skin=", 0) == 0)
+      options.skin = atof(arg.substr(7).c_str());
+    else if (arg == "--approx-error")
+      options.approximationError = true;
+    else if (arg == "--to-binary")
+      options.toBinary = true;
+    else if (arg == "--to-text")
+      options.toText = true;
+    else {
+      cerr << "unknown option: " << arg << endl;
+      return false;
+    }
   }
-  Vector2& operator-=(const Vector2& rhs) {
-    x -= rhs.x;
-    y -= rhs.y;
-    return *this;
+  if (!flocking::isEngine(options.engine)) {
+    cerr << "unknown engine: " << options.engine << endl;
+    return false;
   }
-  Vector2& operator*=(const double& rhs) {
-    x *= rhs;
-    y *= rhs;
-    return *this;
+  if (options.threads < 1) {
+    cerr << "the number of threads must be at least 1" << endl;
+    return false;
   }
-  Vector2& operator/=(const double& rhs) {
-    x /= rhs;
-    y /= rhs;
-    return *this;
+  if (options.cellsPerRadius < 1) {
+    cerr << "the number of cells per radius must be at least 1" << endl;
+    return false;
   }
-  Vector2& operator*=(const Vector2& rhs) {
-    x *= rhs.x;
-    y *= rhs.y;
-    return *this;
+  if (!(options.skin >= 0)) {
+    cerr << "the skin cannot be negative" << endl;
+    return false;
   }
-  Vector2& operator/=(const Vector2& rhs) {
-    x /= rhs.x;
-    y /= rhs.y;
-    return *this;
+  if (options.maxStep < 0 || options.maxSubsteps < 1) {
+    cerr << "the substep length cannot be negative and a tick needs at least 1 substep" << endl;
+    return false;
   }
-
-  double sqrMagnitude() const { return x * x + y * y; }
-  double getMagnitude() const { return sqrt(sqrMagnitude()); }
-  static double getMagnitude(const Vector2& vector) { return vector.getMagnitude(); }
-
-  static double Distance(const Vector2& a, const Vector2& b) { return sqrt((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y)); };
-  double Distance(const Vector2& b) const { return sqrt((x - b.x) * (x - b.x) + (y - b.y) * (y - b.y)); };
-  static double DistanceSquared(const Vector2& a, const Vector2& b) { return (a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y); };
-  double DistanceSquared(const Vector2& b) const { return (x - b.x) * (x - b.x) + (y - b.y) * (y - b.y); };
-
-  static Vector2 normalized(const Vector2& v) { return v.normalized(); };
-  Vector2 normalized() const {
-    auto magnitude = getMagnitude();
-
-    // If the magnitude is not null
-    if (magnitude > 0.)
-      return Vector2(x, y) / magnitude;
-    else
-      return {x, y};
-  };
-
-  static const Vector2 zero;
-};
-
-const Vector2 Vector2::zero = {0, 0};
-
-struct Boid {
-  Boid(const Vector2& pos, const Vector2& vel): position(pos), velocity(vel){};
-  Boid():position({0,0}), velocity({0,0}){};
-  Vector2 position;
-  Vector2 velocity;
-};
-
-struct Cohesion {
-  double radius; //max radius for cohesion
-  double k; //scaling the force
-
-  Cohesion() = default;
-  
-  //boids = vector of all agents
-  //boidAgentIndex = index for the agent that is currently being looked at
-  Vector2 ComputeForce(const vector<Boid>& boids, int boidAgentIndex)
-  {
-    Vector2 centerOfMass = {0,0};
-    int numNeighbours = 0;
-
-    //go through the list of agents
-    for (int i = 0; i < boids.size(); ++i)
-    {
-      if (i != boidAgentIndex)
-      {
-        //if the current boid is NOT the starting boid, find the distance to it
-        double distance = boids[boidAgentIndex].position.Distance(boids[i].position);
-        
-        //if the distance is within the radius...
-        if(distance <= radius)
-        {
-          //...increase center of mass and number of neighbors found
-          centerOfMass += boids[i].position;
-          ++numNeighbours;
-        }
-      }
-    }
-
-    //if no neighbors return zero force
-    if(numNeighbours == 0)
-    {
-      return Vector2(0,0);
-    }
-
-    //calculate average center of mass
-    centerOfMass /= numNeighbours;
-
-    Vector2 directionToCenter = centerOfMass - boids[boidAgentIndex].position;
-    double distanceToCenter = directionToCenter.getMagnitude();
-
-    //compute force of cohesion, capped at the radius 
-    //force is scaled to the distance of the center
-    double forceMagnitude = k * min(distanceToCenter, radius) / radius;
-    Vector2 force = directionToCenter.normalized() * forceMagnitude;
-
-    cout << "Cohesion - Force: " << force.x << " " << force.y << endl;
-    return force;
+  if (options.approximationError && options.engine != "approx") {
+    cerr << "--approx-error needs the approx engine" << endl;
+    return false;
   }
-};
-
-struct Alignment {
-  double radius; //max radius for alignment
-  double k; //scale factor
-
-  Alignment() = default;
-
-  //boids = vector of all agents
-  //boidAgentIndex = index for the agent that is currently being looked at
-  Vector2 ComputeForce(const vector<Boid>& boids, int boidAgentIndex)
-  {
-    Vector2 avgVelocity = {0,0};
-    int numNeighbours = 0;
-
-    // go through the list of agents
-    for (int i = 0; i < boids.size(); ++i)
-    {
-      if(i != boidAgentIndex)
-      {
-        // if the current boid is NOT the starting boid, find the distance to it
-        double distance = boids[boidAgentIndex].position.Distance(boids[i].position);
-
-        // if the distance is within the radius...
-        if(distance <= radius)
-        {
-          //...increase average velocity and number of neighbors 
-          avgVelocity += boids[i].velocity;
-          ++numNeighbours;
-        }
-      }
-    }
-
-    //include velocity of the agent itself
-    avgVelocity += boids[boidAgentIndex].velocity;
-    ++numNeighbours;
-
-    //compute force with average velocity
-    if(numNeighbours > 0)
-    {
-      //average velocity
-      avgVelocity /= numNeighbours;
-
-      //find direction and normalized velocity
-      Vector2 direction = avgVelocity;//.normalized();
-      Vector2 currentVelocity = boids[boidAgentIndex].velocity.normalized();
-
-      //compute alignment force and scale by k 
-      Vector2 alignForce = (direction - currentVelocity) * k;
-
-      cout << "Alignment - Alignment Force: " << alignForce.x << " " << alignForce.y << endl;
-      return alignForce;
-    }
-    //no force if no neighbors
-    return Vector2(0,0);
+  // the fused engines never compute the three forces apart
+  if (!options.tracePath.empty() && options.engine != "reference" && options.engine != "grid") {
+    cerr << "--trace needs the reference or the grid engine" << endl;
+    return false;
   }
-};
-
-struct Separation {
-  double radius; //max radius for alignment
-  double k; //for scaling
-  double maxForce; //maxmimum allowable magnitude for seperation force
-
-  Separation() = default;
-
-  Vector2 ComputeForce(const vector<Boid>& boids, int boidAgentIndex)
-  {
-    Vector2 separationForce = {0, 0};
-    Vector2 agentPos = boids[boidAgentIndex].position;
-    int numNeighbours = 0;
-
-    // boids = vector of all agents
-    // boidAgentIndex = index for the agent that is currently being looked at
-    for (int i = 0; i < boids.size(); ++i)
-    {
-      //if its not the current agent
-      if(i != boidAgentIndex)
-      {
-        //and they are within the radius
-        double distance = agentPos.Distance(boids[i].position);
-
-        if(distance <= radius)
-        {
-          //compute separation forces
-          //direction to neighbor then the force, add force and num of neighbors
-          Vector2 directionToNeighbor = agentPos - boids[i].position;
-          Vector2 force = directionToNeighbor / (distance * distance); //changed to distance squared
-          separationForce += force;
-          ++numNeighbours;
-        }
-      }
-    }
-
-    //if there are any neighbors within the radius compute final force
-    if(numNeighbours > 0)
-    {
-      //average force
-      separationForce /= numNeighbours;
-      //magnitude of force scaled
-      double forceMagnitude = k * separationForce.getMagnitude();
-
-      //make sure it isnt too big
-      if(forceMagnitude > maxForce)
-      {
-        //clamp force
-        separationForce = separationForce.normalized() * maxForce;
-      }
-      else
-      {
-        //scale by coefficient
-        separationForce *= k;
-      }
-    }
-    cout << "Separation - Separation Force: " << separationForce.x << " " << separationForce.y << endl;
-    return separationForce;
+#if !FLOCKING_HAS_SIMD
+  if (options.engine == "simd") {
+    cerr << "the simd engine needs a compiler with vector extensions" << endl;
+    return false;
   }
-};
+#endif
+  if (options.engine == "simd" && options.isa > flocking::detectIsa()) {
+    cerr << "this CPU does not support " << flocking::isaName(options.isa) << endl;
+    return false;
+  }
+  return true;
+}
 
 // feel free to edit this main function to meet your needs
-int main() {
+int main(int argc, char* argv[]) {
+  FlockingOptions options;
+  if (!parseOptions(argc, argv, options))
+    return 1;
+  if (options.toBinary)
+    return flocking::textToBinary(stdin, stdout, options.framePrecision) ? 0 : 1;
+  if (options.toText)
+    return flocking::binaryToText(stdin, stdout) ? 0 : 1;
+
   // Variable declaration
   Separation separation{};
   Alignment alignment{};
   Cohesion cohesion{};
   int numberOfBoids;
   string line; // for reading until EOF
-  vector<Boid> currentState, newState;
+  vector<Boid> currentState;
 
   // Input Reading
-  cin >> cohesion.radius >> separation.radius >> separation.maxForce >> alignment.radius >> cohesion.k >> separation.k >> alignment.k >> numberOfBoids;
-  for (int i = 0; i < numberOfBoids; i++) {
-    Boid b;
-    cin >> b.position.x >> b.position.y >> b.velocity.x >> b.velocity.y;
-    currentState.push_back(b);
-    newState.push_back(b);
+  flocking::InputFileHeader header;
+  vector<uint8_t> frame; // binary frames as read or written
+  if (options.binaryInput) {
+    if (fread(&header, sizeof(header), 1, stdin) != 1 || !header.valid()) {
+      cerr << "invalid binary flock input header" << endl;
+      return 1;
+    }
+    cohesion.radius = header.cohesionRadius;
+    separation.radius = header.separationRadius;
+    separation.maxForce = header.separationMaxForce;
+    alignment.radius = header.alignmentRadius;
+    cohesion.k = header.cohesionK;
+    separation.k = header.separationK;
+    alignment.k = header.alignmentK;
+    numberOfBoids = int(header.boids);
+    currentState.resize(numberOfBoids);
+    if (!flocking::readFrame(stdin, header.precision, currentState, frame)) {
+      cerr << "the flock ends before its " << numberOfBoids << " boids" << endl;
+      return 1;
+    }
+  } else {
+    cin >> cohesion.radius >> separation.radius >> separation.maxForce >> alignment.radius >> cohesion.k >> separation.k >> alignment.k >> numberOfBoids;
+    for (int i = 0; i < numberOfBoids; i++) {
+      Boid b;
+      cin >> b.position.x >> b.position.y >> b.velocity.x >> b.velocity.y;
+      currentState.push_back(b);
+    }
+    cin.ignore(256, '\n');
+  }
+  // the delta time of every tick, one per line or in chunks
+  flocking::DeltaTimeReader deltaTimes(stdin);
+  auto nextDeltaT = [&](double& deltaT) {
+    if (options.binaryInput)
+      return deltaTimes.next(deltaT);
+    if (!getline(cin, line))
+      return false;
+    deltaT = stod(line);
+    return true;
+  };
+
+  flocking::ForceEngine engine(options, cohesion, separation, alignment);
+  engine.setMeasureError(options.approximationError);
+  flocking::Integrator integrator(options, engine);
+  unique_ptr<flocking::ForceTrace> trace;
+  if (!options.tracePath.empty())
+    trace = make_unique<flocking::ForceTrace>(options.traceLimit);
+  int tick = 0;
+
+  flocking::TextWriter text(stdout);
+  // the binary frames bypass the text buffer, so their write errors are kept here
+  bool framesWritten = true;
+  if (options.binaryOutput) {
+    flocking::OutputFileHeader outputHeader;
+    outputHeader.boids = uint32_t(numberOfBoids);
+    outputHeader.precision = options.framePrecision;
+    framesWritten = fwrite(&outputHeader, sizeof(outputHeader), 1, stdout) == 1;
   }
-  cin.ignore(256, '\n');
 
-  while (getline(cin, line)) { // game loop
-    //read from the current and store changes in the new state.
-    currentState = newState;
-    double deltaT = stod(line);
-    // a vector of the sum of forces for each boid.
-    vector<Vector2> allForces = vector<Vector2>(numberOfBoids, {0, 0});
+  double deltaT;
+  while (nextDeltaT(deltaT)) { // game loop
+    // Compute Forces and Tick Time, in substeps when the flock is too fast for deltaT; only
+    // the state at the end of the tick is printed
+    if (trace)
+      trace->beginTick(currentState.size());
+    integrator.advance(currentState, deltaT, trace.get(), tick);
+
+    // Output: 3 decimal places per number, or a binary frame
+    if (options.binaryOutput)
+      framesWritten = framesWritten && flocking::writeFrame(stdout, options.framePrecision, currentState, frame);
+    else
+      for (int i = 0; i < numberOfBoids; i++) // for every boid
+        text.write(currentState[i]);
+    tick++;
+  }
 
-    // Compute Forces
-    for (int i = 0; i < numberOfBoids; i++)  // for every boid
-    {
-      // Calculate Cohesion Force
-      Vector2 cohesionForce = cohesion.ComputeForce(currentState, i);
-      // Calculate Separation Force
-      Vector2 separationForce = separation.ComputeForce(currentState, i);
-      // Calculate Alignment Force
-      Vector2 alignmentForce = alignment.ComputeForce(currentState, i);
+  if (!text.flush() || !framesWritten) {
+    cerr << "cannot write the output" << endl;
+    return 1;
+  }
 
-      // Accumulate the forces
-      allForces[i] += cohesionForce + separationForce + alignmentForce;
-    }
+  if (options.maxStep > 0)
+    cerr << tick << " ticks integrated with " << flocking::schemeName(options.scheme) << " in "
+         << integrator.substepsTaken() << " substeps" << endl;
 
-    // Tick Time and Output
-    // todo: edit this. probably my code will be different than yours.
-    cout << fixed << setprecision(3);  // set 3 decimal places precision for output
+  if (options.engine == "lists") {
+    const flocking::NeighbourLists& lists = engine.neighbourLists();
+    cerr << "neighbour lists rebuilt " << lists.rebuilds() << " times in " << lists.updates()
+         << " force computations, " << lists.meanLength() << " boids per list, "
+         << lists.memoryBytes() << " bytes" << endl;
+  }
 
-    for (int i = 0; i < numberOfBoids; i++) // for every boid
-    {
-      newState[i].velocity += allForces[i] * deltaT;
-      //newState[i].position += currentState[i].velocity * deltaT;
-      newState[i].position += newState[i].velocity * deltaT;
-      cout << newState[i].position.x << " " << newState[i].position.y << " "
-           << newState[i].velocity.x << " " << newState[i].velocity.y << endl;
-    }
-    currentState = newState;
+  if (options.approximationError) {
+    const flocking::ApproximationError& error = engine.approximationError();
+    cerr << "approximation error over " << error.samples << " boid ticks: cohesion mean "
+         << error.cohesionMean() << " max " << error.cohesionMax << ", alignment mean "
+         << error.alignmentMean() << " max " << error.alignmentMax << endl;
+  }
+
+  if (trace) {
+    if (trace->droppedRecords() > 0)
+      cerr << "trace full: " << trace->droppedRecords() << " records dropped, see --trace-limit"
+           << endl;
+    if (!trace->write(options.tracePath))
+      return 1;
   }
 
   return 0;
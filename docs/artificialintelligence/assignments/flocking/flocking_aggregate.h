@@ -0,0 +1,196 @@
+#ifndef FLOCKING_AGGREGATE_H
+#define FLOCKING_AGGREGATE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "flocking_fused.h"
+#include "flocking_grid.h"
+#include "flocking_vector.h"
+
+namespace flocking {
+  // Approximate forces for dense flocks with large radii. Cohesion and alignment only need the
+  // sum of the positions and velocities of the neighbours, so the boids are binned into a grid
+  // of cells `1 / cellsPerRadius` of the largest radius wide, and every cell keeps those sums.
+  // Around a boid:
+  // - a cell entirely inside a radius adds its sums at once, without looking at its boids;
+  // - a cell entirely outside adds nothing;
+  // - a cell the circle cuts through adds its sums when its centre of mass is inside;
+  // - the boid's own cell is always scanned boid by boid, so it never counts itself.
+  // Only the cells the circles cut through are approximated, and there are fewer of them, each
+  // holding fewer boids, as cellsPerRadius grows. Separation weighs every neighbour by its
+  // distance, so its pairs are always scanned exactly, in the cells its radius reaches.
+  class AggregateKernel {
+  public:
+    AggregateKernel(const FlockParameters& parameters, int cellsPerRadius)
+        : parameters(parameters),
+          cellsPerRadius(std::max(cellsPerRadius, 1)),
+          cohesionSquared(squaredRadius(parameters.cohesionRadius)),
+          separationSquared(squaredRadius(parameters.separationRadius)),
+          alignmentSquared(squaredRadius(parameters.alignmentRadius)) {}
+
+    // Bins the boids and adds up every cell.
+    void build(const std::vector<Boid>& boids) {
+      // as many cells per boid as the grid engines have per radius
+      grid.build(boids, parameters.largestRadius() / cellsPerRadius,
+                 4.0 * cellsPerRadius * cellsPerRadius);
+      size_t cells = size_t(grid.columns()) * size_t(grid.rows());
+      sums.assign(cells, CellSums());
+      const std::vector<int>& order = grid.order();
+      for (int y = 0; y < grid.rows(); y++) {
+        for (int x = 0; x < grid.columns(); x++) {
+          CellSums& cell = sums[size_t(y) * grid.columns() + x];
+          auto [first, last] = grid.slots(x, y);
+          for (size_t slot = first; slot < last; slot++) {
+            const Boid& boid = boids[order[slot]];
+            // boids that are not finite are nobody's neighbour
+            if (!std::isfinite(boid.position.x) || !std::isfinite(boid.position.y)) continue;
+            cell.position += boid.position;
+            cell.velocity += boid.velocity;
+            cell.count++;
+          }
+        }
+      }
+    }
+
+    // What the neighbours of boid `index` add up to, approximately for cohesion and alignment.
+    FusedKernel::Sums neighbourSums(const std::vector<Boid>& boids, int index) const {
+      FusedKernel::Sums result;
+      const Vector2 position = boids[index].position;
+      if (!std::isfinite(position.x) || !std::isfinite(position.y)) return result;
+
+      double reach = parameters.largestRadius(), width = grid.cellWidth();
+      int firstX = cellColumn(position.x - reach), lastX = cellColumn(position.x + reach);
+      int firstY = cellRow(position.y - reach), lastY = cellRow(position.y + reach);
+      size_t own = grid.cellOf(index);
+      const std::vector<int>& order = grid.order();
+
+      for (int y = firstY; y <= lastY; y++) {
+        double top = grid.top() + y * width;
+        for (int x = firstX; x <= lastX; x++) {
+          double left = grid.left() + x * width;
+          size_t cellIndex = size_t(y) * grid.columns() + x;
+          const CellSums& cell = sums[cellIndex];
+          if (cell.count == 0) continue;
+
+          // squared distances to the nearest and the farthest point of the cell
+          double nearX = std::max({left - position.x, 0.0, position.x - left - width});
+          double nearY = std::max({top - position.y, 0.0, position.y - top - width});
+          double farX = std::max(std::abs(position.x - left),
+                                 std::abs(position.x - left - width));
+          double farY = std::max(std::abs(position.y - top), std::abs(position.y - top - width));
+          double nearest = nearX * nearX + nearY * nearY, farthest = farX * farX + farY * farY;
+          Vector2 centre = cell.position / cell.count;
+          double centreSquared = (position - centre).sqrMagnitude();
+
+          bool scanCell = cellIndex == own;
+          Use cohesion = use(cohesionSquared, nearest, farthest, centreSquared, scanCell);
+          Use alignment = use(alignmentSquared, nearest, farthest, centreSquared, scanCell);
+          bool scanSeparation = nearest <= separationSquared;
+
+          if (cohesion == Use::Sums) {
+            result.centerOfMass += cell.position;
+            result.cohesionCount += cell.count;
+          }
+          if (alignment == Use::Sums) {
+            result.velocity += cell.velocity;
+            result.alignmentCount += cell.count;
+          }
+          if (cohesion != Use::Boids && alignment != Use::Boids && !scanSeparation) continue;
+
+          auto [first, last] = grid.slots(x, y);
+          for (size_t slot = first; slot < last; slot++) {
+            int i = order[slot];
+            if (i == index) continue;
+            const Vector2& other = boids[i].position;
+            double dx = position.x - other.x, dy = position.y - other.y;
+            double squared = dx * dx + dy * dy;
+            if (cohesion == Use::Boids && squared <= cohesionSquared) {
+              result.centerOfMass += other;
+              result.cohesionCount++;
+            }
+            if (scanSeparation && squared <= separationSquared) {
+              double distance = std::sqrt(squared);
+              result.separation += (position - other) / (distance * distance);
+              result.separationCount++;
+            }
+            if (alignment == Use::Boids && squared <= alignmentSquared) {
+              result.velocity += boids[i].velocity;
+              result.alignmentCount++;
+            }
+          }
+        }
+      }
+      return result;
+    }
+
+    const UniformGrid& cells() const { return grid; }
+    size_t memoryBytes() const {
+      return grid.memoryBytes() + sums.capacity() * sizeof(CellSums);
+    }
+
+  private:
+    struct CellSums {
+      Vector2 position, velocity;
+      int count = 0;
+    };
+    // how a cell takes part in one behaviour
+    enum class Use { Nothing, Sums, Boids };
+
+    FlockParameters parameters;
+    int cellsPerRadius;
+    double cohesionSquared, separationSquared, alignmentSquared;
+    UniformGrid grid;
+    std::vector<CellSums> sums;
+
+    static Use use(double radiusSquared, double nearest, double farthest, double centreSquared,
+                   bool scanCell) {
+      if (nearest > radiusSquared) return Use::Nothing;
+      if (scanCell) return Use::Boids;
+      if (farthest <= radiusSquared || centreSquared <= radiusSquared) return Use::Sums;
+      return Use::Nothing;
+    }
+
+    int cellColumn(double x) const {
+      return clampCell((x - grid.left()) / grid.cellWidth(), grid.columns());
+    }
+    int cellRow(double y) const {
+      return clampCell((y - grid.top()) / grid.cellWidth(), grid.rows());
+    }
+    static int clampCell(double cell, int cells) {
+      if (!(cell >= 0)) return 0;
+      return cell >= cells - 1 ? cells - 1 : int(cell);
+    }
+  };
+
+  // Error of approximate cohesion and alignment forces against the exact ones, over every boid
+  // and tick measured.
+  struct ApproximationError {
+    double cohesionSum = 0, cohesionMax = 0, alignmentSum = 0, alignmentMax = 0;
+    size_t samples = 0;
+
+    void add(const FusedKernel::Forces& approximate, const FusedKernel::Forces& exact) {
+      double cohesion = (approximate.cohesion - exact.cohesion).getMagnitude();
+      double alignment = (approximate.alignment - exact.alignment).getMagnitude();
+      cohesionSum += cohesion;
+      alignmentSum += alignment;
+      cohesionMax = std::max(cohesionMax, cohesion);
+      alignmentMax = std::max(alignmentMax, alignment);
+      samples++;
+    }
+    void add(const ApproximationError& other) {
+      cohesionSum += other.cohesionSum;
+      alignmentSum += other.alignmentSum;
+      cohesionMax = std::max(cohesionMax, other.cohesionMax);
+      alignmentMax = std::max(alignmentMax, other.alignmentMax);
+      samples += other.samples;
+    }
+
+    double cohesionMean() const { return samples > 0 ? cohesionSum / double(samples) : 0; }
+    double alignmentMean() const { return samples > 0 ? alignmentSum / double(samples) : 0; }
+  };
+}  // namespace flocking
+
+#endif
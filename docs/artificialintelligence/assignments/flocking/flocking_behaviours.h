@@ -0,0 +1,198 @@
+#ifndef FLOCKING_BEHAVIOURS_H
+#define FLOCKING_BEHAVIOURS_H
+
+#include <algorithm>
+#include <ranges>
+#include <vector>
+
+#include "flocking_vector.h"
+
+// The three behaviours of the assignment, shared by the simulator and the benchmark.
+struct Cohesion {
+  double radius; //max radius for cohesion
+  double k; //scaling the force
+
+  Cohesion() = default;
+  
+  //boids = vector of all agents
+  //boidAgentIndex = index for the agent that is currently being looked at
+  Vector2 ComputeForce(const std::vector<Boid>& boids, int boidAgentIndex)
+  {
+    return ComputeForce(boids, boidAgentIndex, std::views::iota(0, int(boids.size())));
+  }
+
+  //candidates = indices of the agents that may be within the radius, in increasing order
+  template <class Candidates>
+  Vector2 ComputeForce(const std::vector<Boid>& boids, int boidAgentIndex, const Candidates& candidates)
+  {
+    Vector2 centerOfMass = {0,0};
+    int numNeighbours = 0;
+
+    //go through the list of agents
+    for (int i : candidates)
+    {
+      if (i != boidAgentIndex)
+      {
+        //if the current boid is NOT the starting boid, find the distance to it
+        double distance = boids[boidAgentIndex].position.Distance(boids[i].position);
+        
+        //if the distance is within the radius...
+        if(distance <= radius)
+        {
+          //...increase center of mass and number of neighbors found
+          centerOfMass += boids[i].position;
+          ++numNeighbours;
+        }
+      }
+    }
+
+    //if no neighbors return zero force
+    if(numNeighbours == 0)
+    {
+      return Vector2(0,0);
+    }
+
+    //calculate average center of mass
+    centerOfMass /= numNeighbours;
+
+    Vector2 directionToCenter = centerOfMass - boids[boidAgentIndex].position;
+    double distanceToCenter = directionToCenter.getMagnitude();
+
+    //compute force of cohesion, capped at the radius 
+    //force is scaled to the distance of the center
+    double forceMagnitude = k * std::min(distanceToCenter, radius) / radius;
+    Vector2 force = directionToCenter.normalized() * forceMagnitude;
+
+    return force;
+  }
+};
+
+struct Alignment {
+  double radius; //max radius for alignment
+  double k; //scale factor
+
+  Alignment() = default;
+
+  //boids = vector of all agents
+  //boidAgentIndex = index for the agent that is currently being looked at
+  Vector2 ComputeForce(const std::vector<Boid>& boids, int boidAgentIndex)
+  {
+    return ComputeForce(boids, boidAgentIndex, std::views::iota(0, int(boids.size())));
+  }
+
+  //candidates = indices of the agents that may be within the radius, in increasing order
+  template <class Candidates>
+  Vector2 ComputeForce(const std::vector<Boid>& boids, int boidAgentIndex, const Candidates& candidates)
+  {
+    Vector2 avgVelocity = {0,0};
+    int numNeighbours = 0;
+
+    // go through the list of agents
+    for (int i : candidates)
+    {
+      if(i != boidAgentIndex)
+      {
+        // if the current boid is NOT the starting boid, find the distance to it
+        double distance = boids[boidAgentIndex].position.Distance(boids[i].position);
+
+        // if the distance is within the radius...
+        if(distance <= radius)
+        {
+          //...increase average velocity and number of neighbors 
+          avgVelocity += boids[i].velocity;
+          ++numNeighbours;
+        }
+      }
+    }
+
+    //include velocity of the agent itself
+    avgVelocity += boids[boidAgentIndex].velocity;
+    ++numNeighbours;
+
+    //compute force with average velocity
+    if(numNeighbours > 0)
+    {
+      //average velocity
+      avgVelocity /= numNeighbours;
+
+      //find direction and normalized velocity
+      Vector2 direction = avgVelocity;//.normalized();
+      Vector2 currentVelocity = boids[boidAgentIndex].velocity.normalized();
+
+      //compute alignment force and scale by k 
+      Vector2 alignForce = (direction - currentVelocity) * k;
+
+      return alignForce;
+    }
+    //no force if no neighbors
+    return Vector2(0,0);
+  }
+};
+
+struct Separation {
+  double radius; //max radius for alignment
+  double k; //for scaling
+  double maxForce; //maxmimum allowable magnitude for seperation force
+
+  Separation() = default;
+
+  // boids = vector of all agents
+  // boidAgentIndex = index for the agent that is currently being looked at
+  Vector2 ComputeForce(const std::vector<Boid>& boids, int boidAgentIndex)
+  {
+    return ComputeForce(boids, boidAgentIndex, std::views::iota(0, int(boids.size())));
+  }
+
+  // candidates = indices of the agents that may be within the radius, in increasing order
+  template <class Candidates>
+  Vector2 ComputeForce(const std::vector<Boid>& boids, int boidAgentIndex, const Candidates& candidates)
+  {
+    Vector2 separationForce = {0, 0};
+    Vector2 agentPos = boids[boidAgentIndex].position;
+    int numNeighbours = 0;
+
+    for (int i : candidates)
+    {
+      //if its not the current agent
+      if(i != boidAgentIndex)
+      {
+        //and they are within the radius
+        double distance = agentPos.Distance(boids[i].position);
+
+        if(distance <= radius)
+        {
+          //compute separation forces
+          //direction to neighbor then the force, add force and num of neighbors
+          Vector2 directionToNeighbor = agentPos - boids[i].position;
+          Vector2 force = directionToNeighbor / (distance * distance); //changed to distance squared
+          separationForce += force;
+          ++numNeighbours;
+        }
+      }
+    }
+
+    //if there are any neighbors within the radius compute final force
+    if(numNeighbours > 0)
+    {
+      //average force
+      separationForce /= numNeighbours;
+      //magnitude of force scaled
+      double forceMagnitude = k * separationForce.getMagnitude();
+
+      //make sure it isnt too big
+      if(forceMagnitude > maxForce)
+      {
+        //clamp force
+        separationForce = separationForce.normalized() * maxForce;
+      }
+      else
+      {
+        //scale by coefficient
+        separationForce *= k;
+      }
+    }
+    return separationForce;
+  }
+};
+
+#endif
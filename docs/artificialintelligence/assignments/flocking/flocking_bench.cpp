@@ -0,0 +1,324 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "flocking_behaviours.h"
+#include "flocking_engine.h"
+#include "flocking_fused.h"
+#include "flocking_grid.h"
+#include "flocking_vector.h"
+
+using namespace std;
+
+// benchmark of every flocking engine on generated flocks, results printed as JSON on stdout and
+// progress on stderr, e.g. ai-flocking-bench --max-boids=100000 > flocking-bench.json
+// with --generate=N it prints one generated flock in the input format of ai-flocking instead
+
+struct BenchOptions {
+  // flocks go from minBoids up to maxBoids boids, 10 times more every time
+  int minBoids = 1000, maxBoids = 1000000;
+  // the reference engine compares every pair of boids, so it stops earlier
+  int referenceMaxBoids = 10000;
+  // boids per unit of area: the flock is a square just big enough to hold them at that density
+  double density = 1;
+  // cohesion and alignment radius, and separation radius
+  double radius = 2, separationRadius = 1;
+  // timed ticks per run, after one untimed tick that lets the engine allocate its buffers
+  int ticks = 10;
+  double deltaT = 0.1;
+  // every engine is measured on 1, 2, 4, ... threads up to this many
+  int maxThreads = flocking::defaultThreadCount();
+  // approx engine: cells per largest radius
+  int cellsPerRadius = 4;
+  // lists engine: skin as a fraction of the largest radius
+  double skin = 0.25;
+  uint64_t seed = 1;
+  // engine names to run, all of them when empty
+  vector<string> engines;
+  // when not 0, print a flock of that many boids with `ticks` ticks and exit
+  int generate = 0;
+};
+
+struct BenchResult {
+  string engine, isa, precision;
+  int threads = 1, boids = 0, ticks = 0;
+  double seconds = 0;
+  // boids looked at and boids actually within the largest radius, per boid and tick
+  double candidatesPerQuery = 0, neighboursPerQuery = 0;
+  size_t memoryBytes = 0;
+  // approx engine: mean distance between its cohesion and alignment forces and the exact ones
+  double cohesionError = 0, alignmentError = 0;
+  // lists engine: share of the timed ticks that rebuilt the lists
+  double rebuildsPerTick = 0;
+};
+
+bool parseBenchOptions(int argc, char* argv[], BenchOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    auto value = [&](const char* name) { return arg.substr(string(name).size()); };
+    if (arg.rfind("--min-boids=", 0) == 0)
+      options.minBoids = atoi(value("--min-boids=").c_str());
+    else if (arg.rfind("--max-boids=", 0) == 0)
+      options.maxBoids = atoi(value("--max-boids=").c_str());
+    else if (arg.rfind("--reference-max-boids=", 0) == 0)
+      options.referenceMaxBoids = atoi(value("--reference-max-boids=").c_str());
+    else if (arg.rfind("--density=", 0) == 0)
+      options.density = atof(value("--density=").c_str());
+    else if (arg.rfind("--radius=", 0) == 0)
+      options.radius = atof(value("--radius=").c_str());
+    else if (arg.rfind("--separation-radius=", 0) == 0)
+      options.separationRadius = atof(value("--separation-radius=").c_str());
+    else if (arg.rfind("--ticks=", 0) == 0)
+      options.ticks = atoi(value("--ticks=").c_str());
+    else if (arg.rfind("--delta-t=", 0) == 0)
+      options.deltaT = atof(value("--delta-t=").c_str());
+    else if (arg.rfind("--max-threads=", 0) == 0)
+      options.maxThreads = atoi(value("--max-threads=").c_str());
+    else if (arg.rfind("--cells-per-radius=", 0) == 0)
+      options.cellsPerRadius = atoi(value("--cells-per-radius=").c_str());
+    else if (arg.rfind("--skin=", 0) == 0)
+      options.skin = atof(value("--skin=").c_str());
+    else if (arg.rfind("--seed=", 0) == 0)
+      options.seed = strtoull(value("--seed=").c_str(), nullptr, 10);
+    else if (arg.rfind("--generate=", 0) == 0)
+      options.generate = atoi(value("--generate=").c_str());
+    else if (arg.rfind("--engines=", 0) == 0) {
+      stringstream list(value("--engines="));
+      string engine;
+      while (getline(list, engine, ',')) options.engines.push_back(engine);
+    } else {
+      cerr << "unknown option: " << arg << endl;
+      return false;
+    }
+  }
+  if (options.minBoids < 1 || options.maxBoids < options.minBoids || options.ticks < 1
+      || options.maxThreads < 1 || options.cellsPerRadius < 1 || !(options.density > 0)
+      || !(options.radius > 0) || !(options.separationRadius >= 0) || !(options.skin >= 0)
+      || options.generate < 0) {
+    cerr << "invalid benchmark settings" << endl;
+    return false;
+  }
+  for (const string& engine : options.engines) {
+    if (!flocking::isEngine(engine)) {
+      cerr << "unknown engine: " << engine << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// A generated flock with the behaviours it runs under.
+struct Scenario {
+  Cohesion cohesion{};
+  Separation separation{};
+  Alignment alignment{};
+  vector<Boid> boids;
+};
+
+// flocks are generated from the seed, the boid count and the settings only, with the raw bits
+// of the generator, so every run of the benchmark, on any machine, moves exactly the same boids:
+// positions uniform over a square of `boids / density` area, velocities uniform in [-1, 1]
+Scenario generateScenario(int boids, const BenchOptions& options) {
+  Scenario scenario;
+  scenario.cohesion.radius = options.radius;
+  scenario.cohesion.k = 1;
+  scenario.separation.radius = options.separationRadius;
+  scenario.separation.k = 1;
+  scenario.separation.maxForce = 2;
+  scenario.alignment.radius = options.radius;
+  scenario.alignment.k = 1;
+
+  mt19937_64 random(options.seed * 0x9E3779B97F4A7C15ull + uint64_t(boids));
+  auto unit = [&]() { return double(random() >> 11) * 0x1p-53; };
+  double side = sqrt(boids / options.density);
+  scenario.boids.resize(boids);
+  for (Boid& boid : scenario.boids) {
+    boid.position = {unit() * side, unit() * side};
+    boid.velocity = {unit() * 2 - 1, unit() * 2 - 1};
+  }
+  return scenario;
+}
+
+void printScenario(ostream& out, const Scenario& scenario, const BenchOptions& options) {
+  out << setprecision(17) << scenario.cohesion.radius << " " << scenario.separation.radius << " "
+      << scenario.separation.maxForce << " " << scenario.alignment.radius << " "
+      << scenario.cohesion.k << " " << scenario.separation.k << " " << scenario.alignment.k << "\n"
+      << scenario.boids.size() << "\n";
+  for (const Boid& boid : scenario.boids)
+    out << boid.position.x << " " << boid.position.y << " " << boid.velocity.x << " "
+        << boid.velocity.y << "\n";
+  for (int tick = 0; tick < options.ticks; tick++) out << options.deltaT << "\n";
+}
+
+// boids in the grid cells around every boid, and boids within the largest radius of it, on
+// average over the flock
+void countNeighbours(const Scenario& scenario, BenchResult& grid, BenchResult& everyBoid) {
+  const vector<Boid>& boids = scenario.boids;
+  double radius = max({scenario.cohesion.radius, scenario.separation.radius,
+                       scenario.alignment.radius});
+  double squared = flocking::squaredRadius(radius);
+  flocking::UniformGrid cells;
+  cells.build(boids, radius);
+  vector<int> candidates;
+  size_t candidateCount = 0, neighbourCount = 0;
+  for (int i = 0; i < int(boids.size()); i++) {
+    cells.candidates(i, candidates);
+    candidateCount += candidates.size() - 1;
+    for (int j : candidates) {
+      double dx = boids[i].position.x - boids[j].position.x;
+      double dy = boids[i].position.y - boids[j].position.y;
+      if (j != i && dx * dx + dy * dy <= squared) neighbourCount++;
+    }
+  }
+  grid.candidatesPerQuery = double(candidateCount) / double(boids.size());
+  grid.neighboursPerQuery = double(neighbourCount) / double(boids.size());
+  everyBoid.neighboursPerQuery = grid.neighboursPerQuery;
+  everyBoid.candidatesPerQuery = double(boids.size() - 1);
+}
+
+bool wanted(const BenchOptions& options, const string& engine) {
+  return options.engines.empty()
+         || find(options.engines.begin(), options.engines.end(), engine) != options.engines.end();
+}
+
+// runs one untimed tick, then times options.ticks ticks of forces and integration; the approx
+// engine measures its error during the untimed tick, and the lists engine counts the rebuilds
+// of the timed ticks
+void measure(BenchResult& result, const BenchOptions& options, const Scenario& scenario,
+             const flocking::EngineOptions& engineOptions) {
+  flocking::ForceEngine engine(engineOptions, scenario.cohesion, scenario.separation,
+                               scenario.alignment);
+  vector<Boid> current = scenario.boids, next(current.size());
+  vector<Vector2> forces(current.size());
+  auto tick = [&]() {
+    engine.computeForces(current, forces);
+    engine.integrate(current, forces, options.deltaT, next);
+    swap(current, next);
+  };
+  engine.setMeasureError(engineOptions.engine == "approx");
+  tick();
+  engine.setMeasureError(false);
+  result.cohesionError = engine.approximationError().cohesionMean();
+  result.alignmentError = engine.approximationError().alignmentMean();
+  size_t rebuilds = engine.neighbourLists().rebuilds();
+  auto start = chrono::steady_clock::now();
+  for (int i = 0; i < options.ticks; i++) tick();
+  result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  if (engineOptions.engine == "lists") {
+    const flocking::NeighbourLists& lists = engine.neighbourLists();
+    result.rebuildsPerTick = double(lists.rebuilds() - rebuilds) / options.ticks;
+    result.candidatesPerQuery = lists.meanLength();
+  }
+  result.ticks = options.ticks;
+  result.threads = engine.threads();
+  result.memoryBytes = 2 * current.size() * sizeof(Boid) + forces.size() * sizeof(Vector2)
+                       + engine.memoryBytes();
+}
+
+void printResult(ostream& out, const BenchResult& result) {
+  double boidTicks = double(result.boids) * result.ticks;
+  out << "    {\"engine\": \"" << result.engine << "\", \"isa\": \"" << result.isa
+      << "\", \"precision\": \"" << result.precision << "\", \"threads\": " << result.threads
+      << ", \"boids\": " << result.boids << ", \"ticks\": " << result.ticks
+      << ", \"seconds\": " << result.seconds
+      << ", \"nsPerBoidTick\": " << (boidTicks > 0 ? result.seconds * 1e9 / boidTicks : 0)
+      << ", \"candidatesPerQuery\": " << result.candidatesPerQuery
+      << ", \"neighboursPerQuery\": " << result.neighboursPerQuery
+      << ", \"memoryBytes\": " << result.memoryBytes
+      << ", \"cohesionError\": " << result.cohesionError
+      << ", \"alignmentError\": " << result.alignmentError
+      << ", \"rebuildsPerTick\": " << result.rebuildsPerTick << "}";
+}
+
+int main(int argc, char* argv[]) {
+  BenchOptions options;
+  if (!parseBenchOptions(argc, argv, options))
+    return 1;
+  if (options.generate > 0) {
+    printScenario(cout, generateScenario(options.generate, options), options);
+    return 0;
+  }
+
+  flocking::Isa detected = flocking::detectIsa();
+  // 1, 2, 4, ... threads, and the largest count itself when it is not a power of two
+  vector<int> threadCounts;
+  for (int threads = 1; threads < options.maxThreads; threads *= 2) threadCounts.push_back(threads);
+  threadCounts.push_back(options.maxThreads);
+
+  vector<BenchResult> results;
+  auto report = [&](const BenchResult& result) {
+    results.push_back(result);
+    cerr << result.engine << " " << result.isa << " " << result.precision << " x"
+         << result.threads << " " << result.boids << " boids: " << result.ticks << " ticks in "
+         << result.seconds << " s" << endl;
+  };
+
+  for (int64_t boids = options.minBoids; boids <= options.maxBoids; boids *= 10) {
+    Scenario scenario = generateScenario(int(boids), options);
+    BenchResult gridBase, referenceBase;
+    gridBase.boids = referenceBase.boids = int(boids);
+    gridBase.precision = referenceBase.precision = "double";
+    gridBase.isa = referenceBase.isa = "scalar";
+    countNeighbours(scenario, gridBase, referenceBase);
+
+    for (string engine : {"reference", "grid", "fused", "simd", "approx", "lists"}) {
+      if (!wanted(options, engine) || (engine == "reference" && boids > options.referenceMaxBoids))
+        continue;
+#if !FLOCKING_HAS_SIMD
+      if (engine == "simd") continue;
+#endif
+      flocking::EngineOptions engineOptions;
+      engineOptions.engine = engine;
+      engineOptions.cellsPerRadius = options.cellsPerRadius;
+      engineOptions.skin = options.skin;
+      BenchResult base = engine == "reference" ? referenceBase : gridBase;
+      base.engine = engine;
+
+      // the simd engine on every instruction set the CPU has, in both precisions
+      vector<pair<flocking::Isa, bool>> variants = {{detected, false}};
+      if (engine == "simd") {
+        variants.clear();
+        for (flocking::Isa isa = flocking::Isa::Generic; isa <= detected;
+             isa = flocking::Isa(int(isa) + 1))
+          for (bool singlePrecision : {false, true}) variants.push_back({isa, singlePrecision});
+      }
+      for (auto [isa, singlePrecision] : variants) {
+        for (int threads : threadCounts) {
+          BenchResult result = base;
+          engineOptions.isa = isa;
+          engineOptions.singlePrecision = singlePrecision;
+          engineOptions.threads = threads;
+          if (engine == "simd") {
+            result.isa = flocking::isaName(isa);
+            result.precision = singlePrecision ? "float" : "double";
+          }
+          measure(result, options, scenario, engineOptions);
+          report(result);
+        }
+      }
+    }
+  }
+
+  cout << "{\n  \"machine\": {\"isa\": \"" << flocking::isaName(detected)
+       << "\", \"hardwareThreads\": " << flocking::defaultThreadCount() << "},\n"
+       << "  \"settings\": {\"seed\": " << options.seed << ", \"density\": " << options.density
+       << ", \"radius\": " << options.radius
+       << ", \"separationRadius\": " << options.separationRadius
+       << ", \"cellsPerRadius\": " << options.cellsPerRadius << ", \"skin\": " << options.skin
+       << ", \"ticks\": " << options.ticks << ", \"deltaT\": " << options.deltaT << "},\n"
+       << "  \"results\": [\n";
+  for (size_t i = 0; i < results.size(); i++) {
+    printResult(cout, results[i]);
+    cout << (i + 1 < results.size() ? ",\n" : "\n");
+  }
+  cout << "  ]\n}\n";
+  return 0;
+}
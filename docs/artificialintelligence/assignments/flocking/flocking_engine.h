@@ -0,0 +1,230 @@
+#ifndef FLOCKING_ENGINE_H
+#define FLOCKING_ENGINE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "flocking_aggregate.h"
+#include "flocking_behaviours.h"
+#include "flocking_fused.h"
+#include "flocking_grid.h"
+#include "flocking_neighbours.h"
+#include "flocking_parallel.h"
+#include "flocking_simd.h"
+#include "flocking_trace.h"
+#include "flocking_vector.h"
+
+namespace flocking {
+  // reference: every behaviour scans every boid
+  // grid: every behaviour only scans the boids of the grid cells around the agent
+  // fused: one pass over the same grid cells computes the three behaviours together
+  // simd: the fused pass on structure-of-arrays boids, several neighbours per instruction
+  // approx: cohesion and alignment from per-cell sums, see AggregateKernel
+  // lists: the fused pass over neighbour lists kept for several ticks, see NeighbourLists
+  inline bool isEngine(const std::string& name) {
+    return name == "reference" || name == "grid" || name == "fused" || name == "simd"
+           || name == "approx" || name == "lists";
+  }
+
+  // How the forces of a tick are computed.
+  struct EngineOptions {
+    std::string engine = "reference";
+    // simd engine: instruction set, the widest one the CPU has by default
+    Isa isa = detectIsa();
+    // simd engine: float halves the memory traffic and doubles the lanes, at some precision
+    bool singlePrecision = false;
+    // threads computing the forces and moving the boids; the result is the same for any count
+    int threads = defaultThreadCount();
+    // approx engine: cells per largest radius, more is slower and more accurate
+    int cellsPerRadius = 4;
+    // lists engine: margin of the lists beyond the largest radius, as a fraction of it; a wider
+    // skin means longer lists rebuilt less often
+    double skin = 0.25;
+  };
+
+  // One tick of the flock with any of the engines: the forces on every boid, then every boid
+  // moved by its force. Every boid is handled by the thread owning its slice and only reads the
+  // previous state, so the result is bit for bit the same on any number of threads.
+  class ForceEngine {
+  public:
+    ForceEngine(const EngineOptions& options, const Cohesion& cohesion,
+                const Separation& separation, const Alignment& alignment)
+        : options(options),
+          cohesion(cohesion),
+          separation(separation),
+          alignment(alignment),
+          fused(parametersOf(cohesion, separation, alignment)),
+          aggregate(parametersOf(cohesion, separation, alignment), options.cellsPerRadius),
+          lists(parametersOf(cohesion, separation, alignment), options.skin),
+          pool(options.threads),
+          candidatesOf(pool.size())
+#if FLOCKING_HAS_SIMD
+          ,
+          simdDouble(options.isa),
+          simdFloat(options.isa)
+#endif
+    {
+    }
+
+    // Sum of the three forces on every boid, written to forces[boid], which must have a slot
+    // per boid. When the trace is not null, it gets the three forces of every boid of a tick it
+    // has begun; only the reference and grid engines compute them apart.
+    void computeForces(const std::vector<Boid>& boids, std::vector<Vector2>& forces,
+                       ForceTrace* trace = nullptr, int tick = 0) {
+      if (options.engine == "approx") return computeApproximateForces(boids, forces);
+      if (options.engine == "lists") {
+        lists.update(boids, pool);
+        pool.forEachSlice(boids.size(), [&](int slice, size_t first, size_t last) {
+          for (int i = int(first); i < int(last); i++)
+            forces[i] = fused.force(boids, i, lists.of(slice, i));
+        });
+        return;
+      }
+
+      // the cells are as wide as the largest radius, so one lookup serves all three behaviours
+      bool useGrid = options.engine != "reference";
+      if (useGrid)
+        grid.build(boids, std::max({cohesion.radius, separation.radius, alignment.radius}));
+
+#if FLOCKING_HAS_SIMD
+      if (options.engine == "simd") {
+        // the simd engine works on the boids in grid order, so the threads split the slots
+        if (options.singlePrecision)
+          simdFloat.load(boids, grid);
+        else
+          simdDouble.load(boids, grid);
+        pool.forEachSlice(boids.size(), [&](int, size_t first, size_t last) {
+          if (options.singlePrecision)
+            simdFloat.computeForces(boids, grid, fused, forces, first, last);
+          else
+            simdDouble.computeForces(boids, grid, fused, forces, first, last);
+        });
+        return;
+      }
+#endif
+
+      pool.forEachSlice(boids.size(), [&](int slice, size_t first, size_t last) {
+        // every thread looks up the candidates of its own boids
+        std::vector<int>& candidates = candidatesOf[slice];
+        for (int i = int(first); i < int(last); i++) {
+          if (options.engine == "fused") {
+            grid.candidates(i, candidates);
+            forces[i] = fused.force(boids, i, candidates);
+            continue;
+          }
+
+          Vector2 cohesionForce, separationForce, alignmentForce;
+          if (useGrid) {
+            grid.candidates(i, candidates);
+            cohesionForce = cohesion.ComputeForce(boids, i, candidates);
+            separationForce = separation.ComputeForce(boids, i, candidates);
+            alignmentForce = alignment.ComputeForce(boids, i, candidates);
+          } else {
+            cohesionForce = cohesion.ComputeForce(boids, i);
+            separationForce = separation.ComputeForce(boids, i);
+            alignmentForce = alignment.ComputeForce(boids, i);
+          }
+          if (trace) trace->record(tick, i, cohesionForce, separationForce, alignmentForce);
+          forces[i] = cohesionForce + separationForce + alignmentForce;
+        }
+      });
+    }
+
+    // next = every boid of `boids` after deltaT under its force: the velocity first, then the
+    // position with the new velocity.
+    void integrate(const std::vector<Boid>& boids, const std::vector<Vector2>& forces,
+                   double deltaT, std::vector<Boid>& next) {
+      next.resize(boids.size());
+      pool.forEachSlice(boids.size(), [&](int, size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+          next[i].velocity = boids[i].velocity + forces[i] * deltaT;
+          next[i].position = boids[i].position + next[i].velocity * deltaT;
+        }
+      });
+    }
+
+    // approx engine: when on, every tick also computes the exact forces and adds up how far the
+    // approximate ones are from them
+    void setMeasureError(bool measure) { measureError = measure; }
+    const ApproximationError& approximationError() const { return error; }
+
+    int threads() const { return pool.size(); }
+    // Runs task on the slices of [0, count), each on its own thread, like the engine's own loops.
+    void forEachSlice(size_t count, const std::function<void(int, size_t, size_t)>& task) {
+      pool.forEachSlice(count, task);
+    }
+    const UniformGrid& cells() const { return grid; }
+    const NeighbourLists& neighbourLists() const { return lists; }
+
+    // Memory the engine keeps between ticks, besides the boids and forces given to it.
+    size_t memoryBytes() const {
+      size_t bytes = grid.memoryBytes() + aggregate.memoryBytes() + lists.memoryBytes();
+      for (const auto& candidates : candidatesOf) bytes += candidates.capacity() * sizeof(int);
+#if FLOCKING_HAS_SIMD
+      bytes += simdDouble.memoryBytes() + simdFloat.memoryBytes();
+#endif
+      return bytes;
+    }
+
+  private:
+    EngineOptions options;
+    Cohesion cohesion;
+    Separation separation;
+    Alignment alignment;
+    FusedKernel fused;
+    AggregateKernel aggregate;
+    NeighbourLists lists;
+    UniformGrid grid;
+    WorkerPool pool;
+    std::vector<std::vector<int>> candidatesOf;
+    bool measureError = false;
+    ApproximationError error;
+    std::vector<ApproximationError> errorOf;
+#if FLOCKING_HAS_SIMD
+    SimdKernel<double> simdDouble;
+    SimdKernel<float> simdFloat;
+#endif
+
+    void computeApproximateForces(const std::vector<Boid>& boids,
+                                  std::vector<Vector2>& forces) {
+      aggregate.build(boids);
+      if (measureError) {
+        grid.build(boids, std::max({cohesion.radius, separation.radius, alignment.radius}));
+        errorOf.assign(pool.size(), ApproximationError());
+      }
+      pool.forEachSlice(boids.size(), [&](int slice, size_t first, size_t last) {
+        std::vector<int>& candidates = candidatesOf[slice];
+        for (int i = int(first); i < int(last); i++) {
+          FusedKernel::Sums sums = aggregate.neighbourSums(boids, i);
+          forces[i] = fused.finish(boids[i], sums);
+          if (measureError) {
+            grid.candidates(i, candidates);
+            FusedKernel::Sums exact = fused.neighbourSums(boids, i, candidates);
+            errorOf[slice].add(fused.components(boids[i], sums),
+                               fused.components(boids[i], exact));
+          }
+        }
+      });
+      if (measureError)
+        for (const ApproximationError& slice : errorOf) error.add(slice);
+    }
+
+    static FlockParameters parametersOf(const Cohesion& cohesion, const Separation& separation,
+                                        const Alignment& alignment) {
+      FlockParameters parameters;
+      parameters.cohesionRadius = cohesion.radius;
+      parameters.separationRadius = separation.radius;
+      parameters.separationMaxForce = separation.maxForce;
+      parameters.alignmentRadius = alignment.radius;
+      parameters.cohesionK = cohesion.k;
+      parameters.separationK = separation.k;
+      parameters.alignmentK = alignment.k;
+      return parameters;
+    }
+  };
+}  // namespace flocking
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef FLOCKING_FUSED_H
+#define FLOCKING_FUSED_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "flocking_vector.h"
+
+namespace flocking {
+  // Parameters of the three behaviours, in the order the input gives them.
+  struct FlockParameters {
+    double cohesionRadius = 0, separationRadius = 0, separationMaxForce = 0, alignmentRadius = 0;
+    double cohesionK = 0, separationK = 0, alignmentK = 0;
+
+    double largestRadius() const {
+      return std::max({cohesionRadius, separationRadius, alignmentRadius});
+    }
+  };
+
+  // Largest squared distance whose square root is still within `radius`. Since sqrt is correctly
+  // rounded and monotonic, `d2 <= squaredRadius(r)` gives exactly the same answer as
+  // `sqrt(d2) <= r`, without the square root.
+  inline double squaredRadius(double radius) {
+    constexpr double infinity = std::numeric_limits<double>::infinity();
+    if (!(radius >= 0)) return -1;
+    double threshold = radius * radius;
+    while (threshold > 0 && std::sqrt(threshold) > radius)
+      threshold = std::nextafter(threshold, 0.0);
+    while (threshold < infinity && std::sqrt(std::nextafter(threshold, infinity)) <= radius)
+      threshold = std::nextafter(threshold, infinity);
+    return threshold;
+  }
+
+  // Cohesion, separation and alignment in one pass over the candidates: every pair is measured
+  // once, its squared distance compared with the three radii, and the three sums grow together.
+  // The sums and the final forces go through the same operations in the same order as the
+  // Cohesion, Separation and Alignment structs, so the result is the same to the last bit.
+  class FusedKernel {
+  public:
+    explicit FusedKernel(const FlockParameters& parameters)
+        : cohesionSquared(squaredRadius(parameters.cohesionRadius)),
+          separationSquared(squaredRadius(parameters.separationRadius)),
+          alignmentSquared(squaredRadius(parameters.alignmentRadius)),
+          parameters(parameters) {}
+
+    // What the neighbours of one boid add up to, before it is turned into forces.
+    struct Sums {
+      Vector2 centerOfMass, separation, velocity;
+      int cohesionCount = 0, separationCount = 0, alignmentCount = 0;
+    };
+
+    // The three forces on one boid, apart.
+    struct Forces {
+      Vector2 cohesion, separation, alignment;
+    };
+
+    // Sum of the three forces on boid `index`; candidates are indices in increasing order.
+    template <class Candidates>
+    Vector2 force(const std::vector<Boid>& boids, int index, const Candidates& candidates) const {
+      return finish(boids[index], neighbourSums(boids, index, candidates));
+    }
+
+    // What the neighbours of boid `index` among the candidates add up to.
+    template <class Candidates>
+    Sums neighbourSums(const std::vector<Boid>& boids, int index,
+                       const Candidates& candidates) const {
+      const Vector2 position = boids[index].position;
+      Sums sums;
+      for (int i : candidates) {
+        if (i == index) continue;
+        const Vector2& other = boids[i].position;
+        double dx = position.x - other.x, dy = position.y - other.y;
+        double squared = dx * dx + dy * dy;
+        if (squared <= cohesionSquared) {
+          sums.centerOfMass += other;
+          sums.cohesionCount++;
+        }
+        if (squared <= separationSquared) {
+          // the separation force is scaled by the distance squared as the original computes it,
+          // from the rounded distance, which keeps the result bit for bit the same
+          double distance = std::sqrt(squared);
+          sums.separation += (position - other) / (distance * distance);
+          sums.separationCount++;
+        }
+        if (squared <= alignmentSquared) {
+          sums.velocity += boids[i].velocity;
+          sums.alignmentCount++;
+        }
+      }
+      return sums;
+    }
+
+    // Turns the sums over the neighbours of a boid into the sum of the three forces on it.
+    Vector2 finish(const Boid& boid, const Sums& sums) const {
+      Forces forces = components(boid, sums);
+      return forces.cohesion + forces.separation + forces.alignment;
+    }
+
+    // Turns the sums over the neighbours of a boid into the three forces on it.
+    Forces components(const Boid& boid, const Sums& sums) const {
+      return {cohesion(boid.position, sums.centerOfMass, sums.cohesionCount),
+              separation(sums.separation, sums.separationCount),
+              alignment(boid.velocity, sums.velocity, sums.alignmentCount)};
+    }
+
+    // Squared radii to compare squared distances with, see squaredRadius().
+    double cohesionSquared, separationSquared, alignmentSquared;
+
+  private:
+    FlockParameters parameters;
+
+    Vector2 cohesion(const Vector2& position, Vector2 centerOfMass, int count) const {
+      if (count == 0) return {0, 0};
+      centerOfMass /= count;
+      Vector2 directionToCenter = centerOfMass - position;
+      double distanceToCenter = directionToCenter.getMagnitude();
+      double forceMagnitude = parameters.cohesionK
+                              * std::min(distanceToCenter, parameters.cohesionRadius)
+                              / parameters.cohesionRadius;
+      return directionToCenter.normalized() * forceMagnitude;
+    }
+
+    Vector2 separation(Vector2 sum, int count) const {
+      if (count == 0) return sum;
+      sum /= count;
+      if (parameters.separationK * sum.getMagnitude() > parameters.separationMaxForce)
+        return sum.normalized() * parameters.separationMaxForce;
+      return sum * parameters.separationK;
+    }
+
+    // the agent counts as one of its own neighbours
+    Vector2 alignment(const Vector2& velocity, Vector2 sum, int count) const {
+      sum += velocity;
+      sum /= count + 1;
+      return (sum - velocity.normalized()) * parameters.alignmentK;
+    }
+  };
+}  // namespace flocking
+
+#endif
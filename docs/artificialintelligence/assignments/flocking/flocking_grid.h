@@ -0,0 +1,134 @@
+#ifndef FLOCKING_GRID_H
+#define FLOCKING_GRID_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace flocking {
+  // Uniform grid over the boids, rebuilt every tick. Cells are at least as wide as the largest
+  // behaviour radius, so every boid closer than that radius to another one lies in the 3x3 block
+  // of cells around it, and the behaviours only have to look at those cells.
+  class UniformGrid {
+  public:
+    // Sorts the boids into cells of at least `radius`, with at most about `cellsPerBoid` cells
+    // per boid. Boids is anything indexable whose elements have a `position` with `x` and `y`.
+    template <class Boids> void build(const Boids& boids, double radius, double cellsPerBoid = 4) {
+      size_t count = boids.size();
+      bool any = false;
+      double minX = 0, minY = 0, maxX = 0, maxY = 0;
+      for (size_t i = 0; i < count; i++) {
+        double x = boids[i].position.x, y = boids[i].position.y;
+        if (!std::isfinite(x) || !std::isfinite(y)) continue;
+        if (!any) {
+          minX = maxX = x;
+          minY = maxY = y;
+          any = true;
+        }
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+      }
+      originX = minX;
+      originY = minY;
+
+      // a little wider than the radius, so rounding in the cell lookup can never push a boid
+      // at exactly the radius two cells away; then wider still if the flock is so spread out
+      // that the grid would have many more cells than boids
+      cellSize = std::max(radius, 1e-9) * (1 + 1e-9);
+      double width = maxX - minX, height = maxY - minY;
+      double maxCells = cellsPerBoid * double(count) + 16;
+      while ((width / cellSize + 1) * (height / cellSize + 1) > maxCells) cellSize *= 2;
+      cellsX = int(width / cellSize) + 1;
+      cellsY = int(height / cellSize) + 1;
+
+      // counting sort of the boids by cell, which keeps them in index order inside every cell
+      cellOfBoid.resize(count);
+      cellStart.assign(size_t(cellsX) * cellsY + 1, 0);
+      for (size_t i = 0; i < count; i++) {
+        cellOfBoid[i] = cellIndex(cellX(boids[i].position.x), cellY(boids[i].position.y));
+        cellStart[cellOfBoid[i] + 1]++;
+      }
+      for (size_t c = 1; c < cellStart.size(); c++) cellStart[c] += cellStart[c - 1];
+      boidsByCell.resize(count);
+      fill.assign(cellStart.begin(), cellStart.end() - 1);
+      for (size_t i = 0; i < count; i++) boidsByCell[fill[cellOfBoid[i]]++] = int(i);
+    }
+
+    // Every boid in the 3x3 cells around boid `index`, itself included, in increasing index
+    // order, which is the order the brute-force loops visit them in.
+    void candidates(int index, std::vector<int>& out) const {
+      out.clear();
+      int cx = int(cellOfBoid[index] % size_t(cellsX));
+      int cy = int(cellOfBoid[index] / size_t(cellsX));
+      for (int y = std::max(cy - 1, 0); y <= std::min(cy + 1, cellsY - 1); y++) {
+        for (int x = std::max(cx - 1, 0); x <= std::min(cx + 1, cellsX - 1); x++) {
+          size_t cell = cellIndex(x, y);
+          out.insert(out.end(), boidsByCell.begin() + cellStart[cell],
+                     boidsByCell.begin() + cellStart[cell + 1]);
+        }
+      }
+      std::sort(out.begin(), out.end());
+    }
+
+    // Boids sorted by cell, in index order inside every cell.
+    const std::vector<int>& order() const { return boidsByCell; }
+
+    // The 3x3 cells around boid `index` as runs of positions in order(): the cells of one row
+    // of the grid are next to each other, so every row of the block is one run. Returns the
+    // number of runs, at most 3.
+    int runs(int index, size_t (&out)[3][2]) const {
+      int cx = int(cellOfBoid[index] % size_t(cellsX));
+      int cy = int(cellOfBoid[index] / size_t(cellsX));
+      int first = std::max(cx - 1, 0), last = std::min(cx + 1, cellsX - 1), count = 0;
+      for (int y = std::max(cy - 1, 0); y <= std::min(cy + 1, cellsY - 1); y++) {
+        out[count][0] = cellStart[cellIndex(first, y)];
+        out[count][1] = cellStart[cellIndex(last, y) + 1];
+        count++;
+      }
+      return count;
+    }
+
+    int columns() const { return cellsX; }
+    int rows() const { return cellsY; }
+
+    // Side of the cells and corner of the cell at column 0, row 0.
+    double cellWidth() const { return cellSize; }
+    double left() const { return originX; }
+    double top() const { return originY; }
+
+    // Cell of boid `index`, as column + row * columns().
+    size_t cellOf(int index) const { return cellOfBoid[index]; }
+
+    // Positions in order() of the boids in the cell at column x, row y, as [first, last).
+    std::pair<size_t, size_t> slots(int x, int y) const {
+      size_t cell = cellIndex(x, y);
+      return {cellStart[cell], cellStart[cell + 1]};
+    }
+
+    size_t memoryBytes() const {
+      return (cellOfBoid.capacity() + cellStart.capacity() + fill.capacity()) * sizeof(size_t)
+             + boidsByCell.capacity() * sizeof(int);
+    }
+
+  private:
+    double originX = 0, originY = 0, cellSize = 1;
+    int cellsX = 1, cellsY = 1;
+    std::vector<size_t> cellOfBoid, cellStart, fill;
+    std::vector<int> boidsByCell;
+
+    // boids that are not finite only ever fail the distance tests, so any cell will do
+    int cellX(double x) const { return clampCell((x - originX) / cellSize, cellsX); }
+    int cellY(double y) const { return clampCell((y - originY) / cellSize, cellsY); }
+    static int clampCell(double cell, int cells) {
+      if (!(cell >= 0)) return 0;
+      return cell >= cells - 1 ? cells - 1 : int(cell);
+    }
+    size_t cellIndex(int x, int y) const { return size_t(y) * size_t(cellsX) + size_t(x); }
+  };
+}  // namespace flocking
+
+#endif
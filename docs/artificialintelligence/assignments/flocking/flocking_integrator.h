@@ -0,0 +1,191 @@
+#ifndef FLOCKING_INTEGRATOR_H
+#define FLOCKING_INTEGRATOR_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "flocking_engine.h"
+#include "flocking_trace.h"
+#include "flocking_vector.h"
+
+namespace flocking {
+  // euler: semi-implicit Euler, the velocity first and the position with the new velocity
+  // verlet: velocity Verlet, the force at the end of a substep is also the force at the start of
+  //   the next one, across ticks too, so after the first tick it costs one force computation per
+  //   substep like euler
+  // rk2: Heun's method, the mean of the forces at the start and at the predicted end of every
+  //   substep, two force computations per substep
+  enum class Scheme { Euler, Verlet, Rk2 };
+
+  inline const char* schemeName(Scheme scheme) {
+    switch (scheme) {
+      case Scheme::Verlet:
+        return "verlet";
+      case Scheme::Rk2:
+        return "rk2";
+      default:
+        return "euler";
+    }
+  }
+
+  inline bool parseScheme(const std::string& name, Scheme& scheme) {
+    for (Scheme known : {Scheme::Euler, Scheme::Verlet, Scheme::Rk2}) {
+      if (name == schemeName(known)) {
+        scheme = known;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // How a tick is integrated.
+  struct IntegratorOptions {
+    Scheme scheme = Scheme::Euler;
+    // longest distance a boid may travel in one substep, from its speed and its force; 0 never
+    // cuts a tick into substeps
+    double maxStep = 0;
+    // substeps of a tick at most, whatever the speeds and forces
+    int maxSubsteps = 64;
+  };
+
+  // Moves the flock by a whole tick, in as many substeps as its fastest boid and its largest
+  // force need: a substep h is short enough that h * speed + h * h * force stays within maxStep
+  // for every boid. Only the state at the end of the tick is handed back, so a long tick costs
+  // one line of input and one frame of output however many substeps it takes.
+  class Integrator {
+  public:
+    Integrator(const IntegratorOptions& options, ForceEngine& engine)
+        : options(options), engine(engine) {}
+
+    // boids = the flock after deltaT, given the flock the previous call handed back. When the
+    // trace is not null, it gets the forces at the start of the tick. Returns the number of
+    // substeps taken.
+    int advance(std::vector<Boid>& boids, double deltaT, ForceTrace* trace = nullptr,
+                int tick = 0) {
+      forces.resize(boids.size());
+      if (!forcesCarried) {
+        engine.computeForces(boids, forces, trace, tick);
+      } else if (trace) {
+        // the trace gets the forces at the start of the tick without replacing the carried ones,
+        // so tracing does not change the output
+        predictedForces.resize(boids.size());
+        engine.computeForces(boids, predictedForces, trace, tick);
+      }
+      // Verlet ends the tick with the forces that start the next one
+      forcesCarried = options.scheme == Scheme::Verlet;
+      int count = substeps(boids, deltaT);
+      double h = deltaT / count;
+      for (int substep = 0; substep < count; substep++) {
+        // the forces at the start of the first substep are already known
+        if (substep > 0 && options.scheme != Scheme::Verlet)
+          engine.computeForces(boids, forces);
+        switch (options.scheme) {
+          case Scheme::Verlet:
+            verletStep(boids, h);
+            break;
+          case Scheme::Rk2:
+            heunStep(boids, h);
+            break;
+          default:
+            engine.integrate(boids, forces, h, next);
+            break;
+        }
+        std::swap(boids, next);
+      }
+      totalSubsteps += size_t(count);
+      return count;
+    }
+
+    // substeps taken by every tick advanced so far
+    size_t substepsTaken() const { return totalSubsteps; }
+
+    // Memory kept between ticks, besides the boids.
+    size_t memoryBytes() const {
+      return forces.capacity() * sizeof(Vector2) + next.capacity() * sizeof(Boid)
+             + predicted.capacity() * sizeof(Boid) + predictedForces.capacity() * sizeof(Vector2);
+    }
+
+  private:
+    IntegratorOptions options;
+    ForceEngine& engine;
+    std::vector<Vector2> forces, predictedForces;
+    std::vector<Boid> next, predicted;
+    std::vector<double> speedOf, forceOf;
+    size_t totalSubsteps = 0;
+    bool forcesCarried = false;
+
+    // Substeps deltaT needs with the current speeds and forces. Boids that are not finite are
+    // left out, they would ask for the maximum every tick.
+    int substeps(const std::vector<Boid>& boids, double deltaT) {
+      if (options.maxStep <= 0 || options.maxSubsteps <= 1) return 1;
+      speedOf.assign(engine.threads(), 0.0);
+      forceOf.assign(engine.threads(), 0.0);
+      engine.forEachSlice(boids.size(), [&](int slice, size_t first, size_t last) {
+        double speed = 0, force = 0;
+        for (size_t i = first; i < last; i++) {
+          double v = boids[i].velocity.sqrMagnitude(), f = forces[i].sqrMagnitude();
+          if (v > speed && std::isfinite(v)) speed = v;
+          if (f > force && std::isfinite(f)) force = f;
+        }
+        speedOf[slice] = speed;
+        forceOf[slice] = force;
+      });
+      double speed = std::sqrt(*std::max_element(speedOf.begin(), speedOf.end()));
+      double force = std::sqrt(*std::max_element(forceOf.begin(), forceOf.end()));
+
+      // the positive root of h * speed + h * h * force = maxStep
+      double d = options.maxStep;
+      double h = 2 * d / (speed + std::sqrt(speed * speed + 4 * force * d));
+      double count = std::ceil(std::abs(deltaT) / h);
+      if (!(count < options.maxSubsteps)) return options.maxSubsteps;
+      return std::max(1, int(count));
+    }
+
+    // x' = x + v h + F h^2 / 2, then v' = v + (F + F') h / 2 with F' the force at x' and the
+    // velocity Euler predicts; F' starts the next substep.
+    void verletStep(const std::vector<Boid>& boids, double h) {
+      next.resize(boids.size());
+      engine.forEachSlice(boids.size(), [&](int, size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+          next[i].position = boids[i].position + boids[i].velocity * h + forces[i] * (h * h / 2);
+          next[i].velocity = boids[i].velocity + forces[i] * h;
+        }
+      });
+      predictedForces.resize(boids.size());
+      engine.computeForces(next, predictedForces);
+      engine.forEachSlice(boids.size(), [&](int, size_t first, size_t last) {
+        for (size_t i = first; i < last; i++)
+          next[i].velocity = boids[i].velocity + (forces[i] + predictedForces[i]) * (h / 2);
+      });
+      std::swap(forces, predictedForces);
+    }
+
+    // Euler predicts the end of the substep, then the position and the velocity move by the mean
+    // of their rates at both ends.
+    void heunStep(const std::vector<Boid>& boids, double h) {
+      predicted.resize(boids.size());
+      engine.forEachSlice(boids.size(), [&](int, size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+          predicted[i].position = boids[i].position + boids[i].velocity * h;
+          predicted[i].velocity = boids[i].velocity + forces[i] * h;
+        }
+      });
+      predictedForces.resize(boids.size());
+      engine.computeForces(predicted, predictedForces);
+      next.resize(boids.size());
+      engine.forEachSlice(boids.size(), [&](int, size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+          next[i].position =
+              boids[i].position + (boids[i].velocity + predicted[i].velocity) * (h / 2);
+          next[i].velocity = boids[i].velocity + (forces[i] + predictedForces[i]) * (h / 2);
+        }
+      });
+    }
+  };
+}  // namespace flocking
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef FLOCKING_NEIGHBOURS_H
+#define FLOCKING_NEIGHBOURS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "flocking_fused.h"
+#include "flocking_grid.h"
+#include "flocking_parallel.h"
+#include "flocking_vector.h"
+
+namespace flocking {
+  // Verlet neighbour lists: every boid keeps the boids within the largest radius plus a skin of
+  // it, found with a grid of that width. As long as no boid has moved more than half the skin
+  // since, no two boids got closer by more than the skin, so every boid within the largest radius
+  // is still on the list and the grid does not have to be rebuilt. The lists keep the increasing
+  // index order of the grid candidates, so the fused kernel gives the same forces from them.
+  class NeighbourLists {
+  public:
+    // The boids on the list of one boid, in increasing index order.
+    struct List {
+      const int* first;
+      const int* last;
+      const int* begin() const { return first; }
+      const int* end() const { return last; }
+      size_t size() const { return size_t(last - first); }
+    };
+
+    // skin is a fraction of the largest radius
+    NeighbourLists(const FlockParameters& parameters, double skin)
+        : skin(std::max(skin, 0.0) * parameters.largestRadius()),
+          radius(parameters.largestRadius()) {
+      // a hair longer than radius + skin, so rounding never drops a boid that is on the edge
+      listRadius = (radius + this->skin) * (1 + 1e-9);
+      listSquared = squaredRadius(listRadius);
+      halfSkinSquared = this->skin * this->skin / 4;
+    }
+
+    // Brings the lists up to date with the boids, rebuilding them when they are stale. The
+    // lists are kept per slice of the pool, every thread looking after the lists of its boids.
+    void update(const std::vector<Boid>& boids, WorkerPool& pool) {
+      queries++;
+      if (stale(boids, pool)) rebuild(boids, pool);
+    }
+
+    // The list of boid `index`, which is in slice `slice` of the pool given to update().
+    List of(int slice, int index) const {
+      const Slice& lists = slices[slice];
+      const size_t* offsets = lists.offsets.data() + (size_t(index) - lists.first);
+      return {lists.neighbours.data() + offsets[0], lists.neighbours.data() + offsets[1]};
+    }
+
+    // times the lists were updated and times they had to be rebuilt
+    size_t updates() const { return queries; }
+    size_t rebuilds() const { return builds; }
+
+    // boids on the lists, on average per boid
+    double meanLength() const {
+      size_t boids = 0, neighbours = 0;
+      for (const Slice& lists : slices) {
+        boids += lists.offsets.empty() ? 0 : lists.offsets.size() - 1;
+        neighbours += lists.neighbours.size();
+      }
+      return boids > 0 ? double(neighbours) / double(boids) : 0;
+    }
+
+    size_t memoryBytes() const {
+      size_t bytes = grid.memoryBytes() + anchors.capacity() * sizeof(Vector2)
+                     + staleOf.capacity() * sizeof(char);
+      for (const Slice& lists : slices)
+        bytes += lists.offsets.capacity() * sizeof(size_t)
+                 + lists.neighbours.capacity() * sizeof(int)
+                 + lists.candidates.capacity() * sizeof(int);
+      return bytes;
+    }
+
+  private:
+    struct Slice {
+      // first boid of the slice, and where the list of boid first + k starts in neighbours
+      size_t first = 0;
+      std::vector<size_t> offsets;
+      std::vector<int> neighbours, candidates;
+    };
+
+    double skin, radius, listRadius, listSquared, halfSkinSquared;
+    UniformGrid grid;
+    // positions of the boids when the lists were built
+    std::vector<Vector2> anchors;
+    std::vector<Slice> slices;
+    std::vector<char> staleOf;
+    size_t queries = 0, builds = 0;
+
+    // Whether some boid moved more than half the skin since the lists were built. A boid that
+    // is no longer finite counts as moved; one that never was is nobody's neighbour anyway.
+    bool stale(const std::vector<Boid>& boids, WorkerPool& pool) {
+      if (anchors.size() != boids.size() || int(slices.size()) != pool.size()) return true;
+      staleOf.assign(pool.size(), 0);
+      pool.forEachSlice(boids.size(), [&](int slice, size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+          double moved = (boids[i].position - anchors[i]).sqrMagnitude();
+          bool wasFinite = std::isfinite(anchors[i].x) && std::isfinite(anchors[i].y);
+          if (moved > halfSkinSquared || (std::isnan(moved) && wasFinite)) {
+            staleOf[slice] = 1;
+            return;
+          }
+        }
+      });
+      return std::find(staleOf.begin(), staleOf.end(), 1) != staleOf.end();
+    }
+
+    void rebuild(const std::vector<Boid>& boids, WorkerPool& pool) {
+      builds++;
+      grid.build(boids, listRadius);
+      anchors.resize(boids.size());
+      slices.resize(pool.size());
+      pool.forEachSlice(boids.size(), [&](int slice, size_t first, size_t last) {
+        Slice& lists = slices[slice];
+        lists.first = first;
+        lists.offsets.assign(1, 0);
+        lists.neighbours.clear();
+        for (size_t i = first; i < last; i++) {
+          const Vector2 position = boids[i].position;
+          anchors[i] = position;
+          grid.candidates(int(i), lists.candidates);
+          for (int j : lists.candidates) {
+            double dx = position.x - boids[j].position.x, dy = position.y - boids[j].position.y;
+            if (j != int(i) && dx * dx + dy * dy <= listSquared) lists.neighbours.push_back(j);
+          }
+          lists.offsets.push_back(lists.neighbours.size());
+        }
+      });
+    }
+  };
+}  // namespace flocking
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef FLOCKING_PARALLEL_H
+#define FLOCKING_PARALLEL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace flocking {
+  // Number of threads used when none is asked for.
+  inline int defaultThreadCount() { return std::max(1u, std::thread::hardware_concurrency()); }
+
+  // Threads kept alive for the whole run, so every tick hands them work instead of starting new
+  // ones. The work is always cut into the same contiguous slices, one per thread, and the caller
+  // works on the first slice itself.
+  class WorkerPool {
+  public:
+    explicit WorkerPool(int threads) : threads(std::max(threads, 1)) {
+      workers.reserve(this->threads - 1);
+      for (int slice = 1; slice < this->threads; slice++)
+        workers.emplace_back([this, slice]() { work(slice); });
+    }
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+    ~WorkerPool() {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+      }
+      started.notify_all();
+      for (auto& worker : workers) worker.join();
+    }
+
+    int size() const { return threads; }
+
+    // Calls task(slice, begin, end) for the slices of [0, count) and returns once all of them are
+    // done. A slice only depends on count and the number of threads, so which thread handles
+    // which elements never changes the result.
+    void forEachSlice(size_t count, const std::function<void(int, size_t, size_t)>& task) {
+      if (threads == 1) {
+        task(0, 0, count);
+        return;
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &task;
+        jobCount = count;
+        pending = threads - 1;
+        generation++;
+      }
+      started.notify_all();
+      runSlice(0);
+      std::unique_lock<std::mutex> lock(mutex);
+      finished.wait(lock, [this]() { return pending == 0; });
+      job = nullptr;
+    }
+
+  private:
+    int threads;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable started, finished;
+    const std::function<void(int, size_t, size_t)>* job = nullptr;
+    size_t jobCount = 0;
+    int pending = 0;
+    unsigned generation = 0;
+    bool stopping = false;
+
+    void runSlice(int slice) {
+      size_t begin = jobCount * slice / threads, end = jobCount * (slice + 1) / threads;
+      if (begin < end) (*job)(slice, begin, end);
+    }
+
+    void work(int slice) {
+      unsigned seen = 0;
+      while (true) {
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          started.wait(lock, [&]() { return stopping || generation != seen; });
+          if (stopping) return;
+          seen = generation;
+        }
+        runSlice(slice);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--pending == 0) finished.notify_one();
+      }
+    }
+  };
+}  // namespace flocking
+
+#endif
@@ -0,0 +1,259 @@
+#ifndef FLOCKING_SIMD_H
+#define FLOCKING_SIMD_H
+
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "flocking_fused.h"
+#include "flocking_grid.h"
+#include "flocking_vector.h"
+
+// The kernels are written with GCC/Clang vector extensions, which compile to whatever the
+// function they are inlined into targets: SSE2 or NEON by default, AVX2 in the function marked
+// with FLOCKING_TARGET. There is no AVX-512 version: GCC lowers 64-byte vector comparisons to
+// one scalar comparison per lane, which made it ten times slower than AVX2.
+#if defined(__GNUC__) || defined(__clang__)
+#  define FLOCKING_HAS_SIMD 1
+#  define FLOCKING_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#  define FLOCKING_HAS_SIMD 0
+#endif
+#if FLOCKING_HAS_SIMD && (defined(__x86_64__) || defined(__i386__))
+#  define FLOCKING_X86_SIMD 1
+#  define FLOCKING_TARGET(isa) __attribute__((target(isa)))
+#else
+#  define FLOCKING_X86_SIMD 0
+#endif
+
+namespace flocking {
+  // Instruction sets the simd engine can use: 16-byte vectors, which every 64-bit CPU has, and
+  // 32-byte ones.
+  enum class Isa { Generic, Avx2 };
+
+  inline const char* isaName(Isa isa) {
+    switch (isa) {
+      case Isa::Avx2: return "avx2";
+      default: return "generic";
+    }
+  }
+
+  inline bool parseIsa(const std::string& name, Isa& isa) {
+    for (Isa candidate : {Isa::Generic, Isa::Avx2}) {
+      if (name == isaName(candidate)) {
+        isa = candidate;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Widest instruction set this CPU runs.
+  inline Isa detectIsa() {
+#if FLOCKING_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return Isa::Avx2;
+#endif
+    return Isa::Generic;
+  }
+
+  // Allocator for the boid arrays: every array starts on a cache line.
+  template <class T> struct AlignedAllocator {
+    using value_type = T;
+    static constexpr std::align_val_t alignment{64};
+
+    AlignedAllocator() = default;
+    template <class U> AlignedAllocator(const AlignedAllocator<U>&) {}
+
+    T* allocate(size_t count) { return static_cast<T*>(::operator new(count * sizeof(T), alignment)); }
+    void deallocate(T* pointer, size_t) { ::operator delete(pointer, alignment); }
+
+    template <class U> bool operator==(const AlignedAllocator<U>&) const { return true; }
+    template <class U> bool operator!=(const AlignedAllocator<U>&) const { return false; }
+  };
+
+  template <class T> using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+  // Boids as a structure of arrays, in the order of the grid cells so that the boids around one
+  // agent are three contiguous runs. Every array is followed by a full vector of padding, so a
+  // vector load that starts on the last boid never reads past the end.
+  template <class T> struct BoidArrays {
+    static constexpr size_t padding = 64 / sizeof(T);
+    AlignedVector<T> x, y, vx, vy;
+    size_t count = 0;
+
+    void load(const std::vector<Boid>& boids, const std::vector<int>& order) {
+      count = order.size();
+      // the padding is never counted, since the kernels mask every lane past the end of a run
+      constexpr T nothing = std::numeric_limits<T>::quiet_NaN();
+      for (AlignedVector<T>* array : {&x, &y, &vx, &vy}) array->assign(count + padding, nothing);
+      for (size_t slot = 0; slot < count; slot++) {
+        const Boid& boid = boids[order[slot]];
+        x[slot] = T(boid.position.x);
+        y[slot] = T(boid.position.y);
+        vx[slot] = T(boid.velocity.x);
+        vy[slot] = T(boid.velocity.y);
+      }
+    }
+  };
+
+#if FLOCKING_HAS_SIMD
+  // Vector of `Bytes` bytes of T, and the integer vector its comparisons give.
+  template <class T, int Bytes> struct SimdTypes {
+    typedef T Vector __attribute__((vector_size(Bytes)));
+    using Mask = decltype(Vector{} <= Vector{});
+    static constexpr int lanes = Bytes / int(sizeof(T));
+  };
+
+  // Lane by lane sums of the neighbours of one boid, see FusedKernel::Sums.
+  template <class T, int Bytes> struct LaneSums {
+    using Vector = typename SimdTypes<T, Bytes>::Vector;
+    using Mask = typename SimdTypes<T, Bytes>::Mask;
+    Vector centerX{}, centerY{}, separationX{}, separationY{}, velocityX{}, velocityY{};
+    Mask cohesionCount{}, separationCount{}, alignmentCount{};
+  };
+
+  template <class T, int Bytes>
+  FLOCKING_ALWAYS_INLINE typename SimdTypes<T, Bytes>::Vector loadVector(const T* address) {
+    typename SimdTypes<T, Bytes>::Vector vector;
+    std::memcpy(&vector, address, sizeof(vector));
+    return vector;
+  }
+
+  // Adds the neighbours of the boid in `self` found in the slots [begin, end), a vector of
+  // candidates at a time: the squared distances of all lanes are compared with the three radii
+  // and every sum only takes the lanes that passed.
+  template <class T, int Bytes>
+  FLOCKING_ALWAYS_INLINE void accumulateRun(const BoidArrays<T>& boids, size_t self, size_t begin,
+                                            size_t end, const T (&squaredRadii)[3],
+                                            LaneSums<T, Bytes>& sums) {
+    using Types = SimdTypes<T, Bytes>;
+    using Vector = typename Types::Vector;
+    using Mask = typename Types::Mask;
+
+    Vector zero{}, selfX = zero + boids.x[self], selfY = zero + boids.y[self];
+    Vector cohesion2 = zero + squaredRadii[0], separation2 = zero + squaredRadii[1];
+    Vector alignment2 = zero + squaredRadii[2];
+    // which lanes are inside the run and not the boid itself is worked out in T, from the lane
+    // numbers: SSE2 has no 64-bit integer comparisons, and a run is always short enough for its
+    // slots to be exact in float
+    Vector lane{};
+    for (int i = 0; i < Types::lanes; i++) lane[i] = T(i);
+
+    for (size_t slot = begin; slot < end; slot += Types::lanes) {
+      Vector otherX = loadVector<T, Bytes>(&boids.x[slot]);
+      Vector otherY = loadVector<T, Bytes>(&boids.y[slot]);
+      Vector dx = selfX - otherX, dy = selfY - otherY;
+      Vector squared = dx * dx + dy * dy;
+      Vector remaining = zero + T(end - slot), selfLane = zero + T(double(self) - double(slot));
+      Mask inside = (lane < remaining) & (lane != selfLane);
+
+      Mask cohesion = inside & (squared <= cohesion2);
+      sums.centerX += cohesion ? otherX : zero;
+      sums.centerY += cohesion ? otherY : zero;
+      sums.cohesionCount -= cohesion;
+
+      Mask separation = inside & (squared <= separation2);
+      sums.separationX += separation ? dx / squared : zero;
+      sums.separationY += separation ? dy / squared : zero;
+      sums.separationCount -= separation;
+
+      Mask alignment = inside & (squared <= alignment2);
+      sums.velocityX += alignment ? loadVector<T, Bytes>(&boids.vx[slot]) : zero;
+      sums.velocityY += alignment ? loadVector<T, Bytes>(&boids.vy[slot]) : zero;
+      sums.alignmentCount -= alignment;
+    }
+  }
+
+  // Forces on the boids in the slots [firstSlot, lastSlot), written to forces[boid index]. The
+  // lane sums are added up in double and turned into forces by the fused kernel, from the
+  // original double boids.
+  template <class T, int Bytes>
+  FLOCKING_ALWAYS_INLINE void computeForces(const BoidArrays<T>& arrays,
+                                            const std::vector<Boid>& boids,
+                                            const UniformGrid& grid, const FusedKernel& fused,
+                                            std::vector<Vector2>& forces, size_t firstSlot,
+                                            size_t lastSlot) {
+    const T squaredRadii[3] = {T(fused.cohesionSquared), T(fused.separationSquared),
+                               T(fused.alignmentSquared)};
+    const std::vector<int>& order = grid.order();
+    for (size_t slot = firstSlot; slot < lastSlot; slot++) {
+      int index = order[slot];
+      size_t runs[3][2];
+      int runCount = grid.runs(index, runs);
+      LaneSums<T, Bytes> lanes;
+      for (int r = 0; r < runCount; r++)
+        accumulateRun<T, Bytes>(arrays, slot, runs[r][0], runs[r][1], squaredRadii, lanes);
+
+      FusedKernel::Sums sums;
+      for (int i = 0; i < SimdTypes<T, Bytes>::lanes; i++) {
+        sums.centerOfMass += Vector2(lanes.centerX[i], lanes.centerY[i]);
+        sums.separation += Vector2(lanes.separationX[i], lanes.separationY[i]);
+        sums.velocity += Vector2(lanes.velocityX[i], lanes.velocityY[i]);
+        sums.cohesionCount += int(lanes.cohesionCount[i]);
+        sums.separationCount += int(lanes.separationCount[i]);
+        sums.alignmentCount += int(lanes.alignmentCount[i]);
+      }
+      forces[index] = fused.finish(boids[index], sums);
+    }
+  }
+
+  template <class T>
+  void computeForcesGeneric(const BoidArrays<T>& arrays, const std::vector<Boid>& boids,
+                            const UniformGrid& grid, const FusedKernel& fused,
+                            std::vector<Vector2>& forces, size_t firstSlot, size_t lastSlot) {
+    computeForces<T, 16>(arrays, boids, grid, fused, forces, firstSlot, lastSlot);
+  }
+
+#  if FLOCKING_X86_SIMD
+  template <class T>
+  FLOCKING_TARGET("avx2")
+  void computeForcesAvx2(const BoidArrays<T>& arrays, const std::vector<Boid>& boids,
+                         const UniformGrid& grid, const FusedKernel& fused,
+                         std::vector<Vector2>& forces, size_t firstSlot, size_t lastSlot) {
+    computeForces<T, 32>(arrays, boids, grid, fused, forces, firstSlot, lastSlot);
+  }
+#  endif
+
+  // The fused kernel on structure-of-arrays boids, with vector instructions. T is double, or
+  // float when throughput matters more than the last printed decimal. Lanes add their
+  // neighbours in a different order than the reference loops, so the sums can differ in their
+  // last bits.
+  template <class T> class SimdKernel {
+  public:
+    explicit SimdKernel(Isa isa) : isa(isa) {}
+
+    // Copies the boids into the arrays, in the order of the grid built for them.
+    void load(const std::vector<Boid>& boids, const UniformGrid& grid) {
+      arrays.load(boids, grid.order());
+    }
+
+    // Forces on the boids in the slots [firstSlot, lastSlot) of grid.order(); slices of the
+    // slots can be computed by different threads.
+    void computeForces(const std::vector<Boid>& boids, const UniformGrid& grid,
+                       const FusedKernel& fused, std::vector<Vector2>& forces, size_t firstSlot,
+                       size_t lastSlot) const {
+#  if FLOCKING_X86_SIMD
+      if (isa == Isa::Avx2)
+        return computeForcesAvx2(arrays, boids, grid, fused, forces, firstSlot, lastSlot);
+#  endif
+      computeForcesGeneric(arrays, boids, grid, fused, forces, firstSlot, lastSlot);
+    }
+
+    size_t memoryBytes() const {
+      return (arrays.x.capacity() + arrays.y.capacity() + arrays.vx.capacity()
+              + arrays.vy.capacity())
+             * sizeof(T);
+    }
+
+  private:
+    Isa isa;
+    BoidArrays<T> arrays;
+  };
+#endif
+}  // namespace flocking
+
+#endif
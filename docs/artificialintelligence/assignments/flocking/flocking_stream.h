@@ -0,0 +1,275 @@
+#ifndef FLOCKING_STREAM_H
+#define FLOCKING_STREAM_H
+
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "flocking_vector.h"
+
+namespace flocking {
+  // Header of a binary flock input: the seven numbers of the first line of the text format and
+  // the number of boids. It is followed by one state frame with the boids, then by the delta
+  // times in chunks: a 32-bit count and that many doubles. A chunk of zero, or the end of the
+  // file, ends the run.
+  struct InputFileHeader {
+    char magic[4] = {'F', 'L', 'I', 'N'};
+    uint32_t version = 1;
+    uint32_t boids = 0;
+    // bytes per number in the state frame, 4 for float or 8 for double
+    uint32_t precision = 8;
+    double cohesionRadius = 0, separationRadius = 0, separationMaxForce = 0, alignmentRadius = 0;
+    double cohesionK = 0, separationK = 0, alignmentK = 0;
+
+    bool valid() const {
+      return std::memcmp(magic, "FLIN", 4) == 0 && version == 1
+             && (precision == 4 || precision == 8);
+    }
+  };
+  static_assert(sizeof(InputFileHeader) == 72, "the header keeps the frame 8-byte aligned");
+
+  // Header of a binary flock output, followed by one state frame per tick.
+  struct OutputFileHeader {
+    char magic[4] = {'F', 'L', 'S', 'T'};
+    uint32_t version = 1;
+    uint32_t boids = 0;
+    uint32_t precision = 8;
+
+    bool valid() const {
+      return std::memcmp(magic, "FLST", 4) == 0 && version == 1
+             && (precision == 4 || precision == 8);
+    }
+  };
+  static_assert(sizeof(OutputFileHeader) == 16, "the header keeps the frames 8-byte aligned");
+
+  // A state frame is x, y, vx, vy of every boid in turn, as `precision`-byte floats in the host
+  // byte order.
+  template <class T> void packFrame(const std::vector<Boid>& boids, std::vector<uint8_t>& bytes) {
+    bytes.resize(boids.size() * 4 * sizeof(T));
+    uint8_t* values = bytes.data();
+    for (const Boid& boid : boids) {
+      T frame[4] = {T(boid.position.x), T(boid.position.y), T(boid.velocity.x),
+                    T(boid.velocity.y)};
+      std::memcpy(values, frame, sizeof(frame));
+      values += sizeof(frame);
+    }
+  }
+
+  inline bool writeFrame(std::FILE* out, uint32_t precision, const std::vector<Boid>& boids,
+                         std::vector<uint8_t>& bytes) {
+    if (precision == 4)
+      packFrame<float>(boids, bytes);
+    else
+      packFrame<double>(boids, bytes);
+    return std::fwrite(bytes.data(), 1, bytes.size(), out) == bytes.size();
+  }
+
+  template <class T>
+  void unpackFrame(const std::vector<uint8_t>& bytes, std::vector<Boid>& boids) {
+    const uint8_t* values = bytes.data();
+    for (Boid& boid : boids) {
+      T frame[4];
+      std::memcpy(frame, values, sizeof(frame));
+      boid.position = {double(frame[0]), double(frame[1])};
+      boid.velocity = {double(frame[2]), double(frame[3])};
+      values += sizeof(frame);
+    }
+  }
+
+  // Reads a frame of boids.size() boids.
+  inline bool readFrame(std::FILE* in, uint32_t precision, std::vector<Boid>& boids,
+                        std::vector<uint8_t>& bytes) {
+    bytes.resize(boids.size() * 4 * precision);
+    if (std::fread(bytes.data(), 1, bytes.size(), in) != bytes.size()) return false;
+    if (precision == 4)
+      unpackFrame<float>(bytes, boids);
+    else
+      unpackFrame<double>(bytes, boids);
+    return true;
+  }
+
+  // The delta times after the first frame of a binary input, one chunk read at a time.
+  class DeltaTimeReader {
+  public:
+    explicit DeltaTimeReader(std::FILE* in) : in(in) {}
+
+    bool next(double& deltaT) {
+      if (position == chunk.size()) {
+        uint32_t count = 0;
+        if (std::fread(&count, sizeof(count), 1, in) != 1 || count == 0) return false;
+        chunk.resize(count);
+        position = 0;
+        if (std::fread(chunk.data(), sizeof(double), count, in) != count) {
+          std::cerr << "delta time chunk ends early" << std::endl;
+          return false;
+        }
+      }
+      deltaT = chunk[position++];
+      return true;
+    }
+
+  private:
+    std::FILE* in;
+    std::vector<double> chunk;
+    size_t position = 0;
+  };
+
+  // Writes chunks of delta times, `chunkSize` at a time, and the final empty chunk.
+  class DeltaTimeWriter {
+  public:
+    explicit DeltaTimeWriter(std::FILE* out, size_t chunkSize = 4096)
+        : out(out), chunkSize(chunkSize) {
+      chunk.reserve(chunkSize);
+    }
+
+    void add(double deltaT) {
+      chunk.push_back(deltaT);
+      if (chunk.size() == chunkSize) flush();
+    }
+
+    // Writes what is left and the end of the stream.
+    void finish() {
+      flush();
+      uint32_t end = 0;
+      std::fwrite(&end, sizeof(end), 1, out);
+    }
+
+  private:
+    std::FILE* out;
+    size_t chunkSize;
+    std::vector<double> chunk;
+
+    void flush() {
+      if (chunk.empty()) return;
+      uint32_t count = uint32_t(chunk.size());
+      std::fwrite(&count, sizeof(count), 1, out);
+      std::fwrite(chunk.data(), sizeof(double), chunk.size(), out);
+      chunk.clear();
+    }
+  };
+
+  // The text output of the simulator, "x y vx vy" with three decimals per boid, formatted with
+  // to_chars into a buffer written out in large blocks. to_chars rounds exactly like the
+  // `fixed << setprecision(3)` stream it replaces, so the text is the same byte for byte.
+  class TextWriter {
+  public:
+    explicit TextWriter(std::FILE* out) : out(out) { buffer.resize(capacity); }
+    TextWriter(const TextWriter&) = delete;
+    TextWriter& operator=(const TextWriter&) = delete;
+    ~TextWriter() { flush(); }
+
+    void write(const Boid& boid) {
+      // a double with three decimals needs at most 309 digits before the point
+      if (capacity - used < 4 * 320) flush();
+      char* next = buffer.data() + used;
+      char* end = buffer.data() + capacity;
+      double values[4] = {boid.position.x, boid.position.y, boid.velocity.x, boid.velocity.y};
+      for (int i = 0; i < 4; i++) {
+        next = std::to_chars(next, end, values[i], std::chars_format::fixed, 3).ptr;
+        *next++ = i < 3 ? ' ' : '\n';
+      }
+      used = size_t(next - buffer.data());
+    }
+
+    bool flush() {
+      bool written = std::fwrite(buffer.data(), 1, used, out) == used;
+      used = 0;
+      return written && std::fflush(out) == 0;
+    }
+
+  private:
+    static constexpr size_t capacity = size_t(1) << 16;
+    std::FILE* out;
+    std::vector<char> buffer;
+    size_t used = 0;
+  };
+
+  // Converts the text input format read from `in` into a binary input written to `out`, with
+  // the boids stored as `precision`-byte floats.
+  inline bool textToBinary(std::FILE* in, std::FILE* out, uint32_t precision) {
+    InputFileHeader header;
+    header.precision = precision;
+    int boids;
+    if (std::fscanf(in, "%lf %lf %lf %lf %lf %lf %lf %d", &header.cohesionRadius,
+                    &header.separationRadius, &header.separationMaxForce,
+                    &header.alignmentRadius, &header.cohesionK, &header.separationK,
+                    &header.alignmentK, &boids)
+            != 8
+        || boids < 0) {
+      std::cerr << "invalid flock header" << std::endl;
+      return false;
+    }
+    header.boids = uint32_t(boids);
+    std::vector<Boid> state(header.boids);
+    for (Boid& boid : state) {
+      if (std::fscanf(in, "%lf %lf %lf %lf", &boid.position.x, &boid.position.y,
+                      &boid.velocity.x, &boid.velocity.y)
+          != 4) {
+        std::cerr << "the flock ends before its " << boids << " boids" << std::endl;
+        return false;
+      }
+    }
+    std::fwrite(&header, sizeof(header), 1, out);
+    std::vector<uint8_t> bytes;
+    writeFrame(out, precision, state, bytes);
+
+    DeltaTimeWriter deltaTimes(out);
+    double deltaT;
+    while (std::fscanf(in, "%lf", &deltaT) == 1) deltaTimes.add(deltaT);
+    deltaTimes.finish();
+    return std::ferror(out) == 0;
+  }
+
+  // Converts a binary input back into the text input format, or a binary output into the text
+  // the simulator prints.
+  inline bool binaryToText(std::FILE* in, std::FILE* out) {
+    char magic[4];
+    if (std::fread(magic, sizeof(magic), 1, in) != 1) {
+      std::cerr << "invalid binary flock" << std::endl;
+      return false;
+    }
+    std::vector<uint8_t> bytes;
+    if (std::memcmp(magic, "FLIN", 4) == 0) {
+      InputFileHeader header;
+      if (std::fread(reinterpret_cast<char*>(&header) + 4, sizeof(header) - 4, 1, in) != 1
+          || !header.valid()) {
+        std::cerr << "invalid binary flock input header" << std::endl;
+        return false;
+      }
+      std::vector<Boid> state(header.boids);
+      if (!readFrame(in, header.precision, state, bytes)) {
+        std::cerr << "the flock ends before its " << header.boids << " boids" << std::endl;
+        return false;
+      }
+      std::fprintf(out, "%.17g %.17g %.17g %.17g %.17g %.17g %.17g %u\n", header.cohesionRadius,
+                   header.separationRadius, header.separationMaxForce, header.alignmentRadius,
+                   header.cohesionK, header.separationK, header.alignmentK, header.boids);
+      for (const Boid& boid : state)
+        std::fprintf(out, "%.17g %.17g %.17g %.17g\n", boid.position.x, boid.position.y,
+                     boid.velocity.x, boid.velocity.y);
+      DeltaTimeReader deltaTimes(in);
+      double deltaT;
+      while (deltaTimes.next(deltaT)) std::fprintf(out, "%.17g\n", deltaT);
+      return std::ferror(out) == 0;
+    }
+
+    OutputFileHeader header;
+    if (std::memcmp(magic, "FLST", 4) != 0
+        || std::fread(reinterpret_cast<char*>(&header) + 4, sizeof(header) - 4, 1, in) != 1
+        || !header.valid()) {
+      std::cerr << "invalid binary flock header" << std::endl;
+      return false;
+    }
+    std::vector<Boid> state(header.boids);
+    TextWriter text(out);
+    while (readFrame(in, header.precision, state, bytes))
+      for (const Boid& boid : state) text.write(boid);
+    return text.flush() && std::ferror(out) == 0;
+  }
+}  // namespace flocking
+
+#endif
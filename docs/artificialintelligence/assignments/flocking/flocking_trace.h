@@ -0,0 +1,94 @@
+#ifndef FLOCKING_TRACE_H
+#define FLOCKING_TRACE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "flocking_vector.h"
+
+namespace flocking {
+  // The three forces on one boid during one tick.
+  struct TraceRecord {
+    uint32_t tick = 0;
+    uint32_t boid = 0;
+    double cohesion[2] = {0, 0};
+    double separation[2] = {0, 0};
+    double alignment[2] = {0, 0};
+  };
+  static_assert(sizeof(TraceRecord) == 56, "records are written as they are laid out in memory");
+
+  // Header of a trace file, followed by `records` TraceRecords in the host byte order.
+  struct TraceFileHeader {
+    char magic[4] = {'F', 'L', 'T', 'R'};
+    uint32_t version = 1;
+    uint32_t recordSize = sizeof(TraceRecord);
+    uint32_t reserved = 0;
+    uint64_t records = 0;
+    // records that did not fit in the buffer, always the last ones
+    uint64_t dropped = 0;
+  };
+  static_assert(sizeof(TraceFileHeader) == 32, "the header keeps the records 8-byte aligned");
+
+  // Force components recorded while the flock runs, for debugging the behaviours without
+  // printing in the middle of the tick. The buffer is allocated once, up front, so recording
+  // never allocates; once it is full the remaining records are only counted.
+  //
+  // Every tick gets the records of all its boids at once, in boid order, so the boids of one
+  // tick can be recorded from several threads and the file is the same whatever their order.
+  class ForceTrace {
+  public:
+    explicit ForceTrace(size_t capacity) : capacity(capacity) { records.reserve(capacity); }
+
+    void beginTick(size_t boids) {
+      tickStart = records.size();
+      size_t kept = std::min(boids, capacity - tickStart);
+      records.resize(tickStart + kept);
+      dropped += boids - kept;
+    }
+
+    // Records boid `boid` of the tick last begun.
+    void record(int tick, int boid, const Vector2& cohesion, const Vector2& separation,
+                const Vector2& alignment) {
+      if (tickStart + size_t(boid) >= records.size()) return;
+      TraceRecord& record = records[tickStart + size_t(boid)];
+      record.tick = uint32_t(tick);
+      record.boid = uint32_t(boid);
+      record.cohesion[0] = cohesion.x;
+      record.cohesion[1] = cohesion.y;
+      record.separation[0] = separation.x;
+      record.separation[1] = separation.y;
+      record.alignment[0] = alignment.x;
+      record.alignment[1] = alignment.y;
+    }
+
+    size_t size() const { return records.size(); }
+    uint64_t droppedRecords() const { return dropped; }
+
+    bool write(const std::string& path) const {
+      std::FILE* out = std::fopen(path.c_str(), "wb");
+      if (out == nullptr) {
+        std::cerr << "cannot write the trace to " << path << std::endl;
+        return false;
+      }
+      TraceFileHeader header;
+      header.records = records.size();
+      header.dropped = dropped;
+      std::fwrite(&header, sizeof(header), 1, out);
+      std::fwrite(records.data(), sizeof(TraceRecord), records.size(), out);
+      bool written = std::ferror(out) == 0;
+      return std::fclose(out) == 0 && written;
+    }
+
+  private:
+    std::vector<TraceRecord> records;
+    size_t capacity, tickStart = 0;
+    uint64_t dropped = 0;
+  };
+}  // namespace flocking
+
+#endif
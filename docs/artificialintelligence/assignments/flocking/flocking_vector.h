@@ -0,0 +1,94 @@
+#ifndef FLOCKING_VECTOR_H
+#define FLOCKING_VECTOR_H
+
+#include <cmath>
+
+struct Vector2 {
+  double x=0, y=0;
+  Vector2() : x(0), y(0){};
+  Vector2(double x, double y) : x(x), y(y){};
+  Vector2(const Vector2& v) = default;
+
+  // unary operations
+  Vector2 operator-() const { return {-x, -y}; }
+  Vector2 operator+() const { return {x, y}; }
+
+  // binary operations
+  Vector2 operator-(const Vector2& rhs) const { return {x - rhs.x, y - rhs.y}; }
+  Vector2 operator+(const Vector2& rhs) const { return {x + rhs.x, y + rhs.y}; }
+  Vector2 operator*(const double& rhs) const { return {x * rhs, y * rhs}; }
+  friend Vector2 operator*(const double& lhs, const Vector2& rhs) { return {lhs * rhs.x, lhs * rhs.y}; }
+  Vector2 operator/(const double& rhs) const { return {x / rhs, y / rhs}; }
+  Vector2 operator/(const Vector2& rhs) const { return {x / rhs.x, y / rhs.y}; }
+  bool operator!=(const Vector2& rhs) const { return (*this - rhs).sqrMagnitude() >= 1.0e-6; };
+  bool operator==(const Vector2& rhs) const { return (*this - rhs).sqrMagnitude() < 1.0e-6; };
+
+  // assignment operation
+  Vector2& operator=(Vector2 const& rhs) = default;
+  Vector2& operator=(Vector2&& rhs) = default;
+
+  // compound assignment operations
+  Vector2& operator+=(const Vector2& rhs) {
+    x += rhs.x;
+    y += rhs.y;
+    return *this;
+  }
+  Vector2& operator-=(const Vector2& rhs) {
+    x -= rhs.x;
+    y -= rhs.y;
+    return *this;
+  }
+  Vector2& operator*=(const double& rhs) {
+    x *= rhs;
+    y *= rhs;
+    return *this;
+  }
+  Vector2& operator/=(const double& rhs) {
+    x /= rhs;
+    y /= rhs;
+    return *this;
+  }
+  Vector2& operator*=(const Vector2& rhs) {
+    x *= rhs.x;
+    y *= rhs.y;
+    return *this;
+  }
+  Vector2& operator/=(const Vector2& rhs) {
+    x /= rhs.x;
+    y /= rhs.y;
+    return *this;
+  }
+
+  double sqrMagnitude() const { return x * x + y * y; }
+  double getMagnitude() const { return std::sqrt(sqrMagnitude()); }
+  static double getMagnitude(const Vector2& vector) { return vector.getMagnitude(); }
+
+  static double Distance(const Vector2& a, const Vector2& b) { return std::sqrt((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y)); };
+  double Distance(const Vector2& b) const { return std::sqrt((x - b.x) * (x - b.x) + (y - b.y) * (y - b.y)); };
+  static double DistanceSquared(const Vector2& a, const Vector2& b) { return (a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y); };
+  double DistanceSquared(const Vector2& b) const { return (x - b.x) * (x - b.x) + (y - b.y) * (y - b.y); };
+
+  static Vector2 normalized(const Vector2& v) { return v.normalized(); };
+  Vector2 normalized() const {
+    auto magnitude = getMagnitude();
+
+    // If the magnitude is not null
+    if (magnitude > 0.)
+      return Vector2(x, y) / magnitude;
+    else
+      return {x, y};
+  };
+
+  static const Vector2 zero;
+};
+
+inline const Vector2 Vector2::zero = {0, 0};
+
+struct Boid {
+  Boid(const Vector2& pos, const Vector2& vel): position(pos), velocity(vel){};
+  Boid():position({0,0}), velocity({0,0}){};
+  Vector2 position;
+  Vector2 velocity;
+};
+
+#endif
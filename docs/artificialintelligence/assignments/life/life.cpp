@@ -1,6 +1,20 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <memory>
 #include <vector>
 #include <string>
+
+#include "life_batch.h"
+#include "life_hashlife.h"
+#include "life_packed.h"
+#include "life_parallel.h"
+#include "life_period.h"
+#include "life_simd.h"
+#include "life_sparse.h"
+#include "life_stream.h"
 using namespace std;
 
 //define this struct to represent positions on the GRID
@@ -96,7 +110,7 @@ void printBoard(PointOnGrid2D limits)
         cout << '.';
       }*/
     }
-    cout << endl;
+    cout << '\n';
   }
 }
 
@@ -202,11 +216,462 @@ void step(PointOnGrid2D limits)
   gameBoard = newBoard;
 }
 
-int main(){
+//command line options, the defaults keep the original reference stepper
+struct LifeOptions
+{
+  string engine = "reference";
+  //widest instruction set the simd engine may use, detected from the CPU by default
+  life::Isa isa = life::detectIsa();
+  //threads used by the parallel engine
+  int threads = life::defaultThreadCount();
+  //print engine statistics to stderr, stdout only ever gets the board
+  bool stats = false;
+  //packed board files of the stream engine, text on stdin and stdout when empty
+  string input, output;
+  //lines of the board the stream engine keeps in memory at once
+  int bandLines = 4096;
+  //only convert between the text and the packed file format, without stepping
+  bool toBinary = false, toText = false;
+  //life-like rule of every engine but the reference one, which only runs B3/S23
+  LifeRule rule;
+  //stop stepping once the board repeats itself and jump straight to the last generation
+  bool detectPeriod = false;
+  //read boards until the end of the input and spread them over the threads
+  bool batch = false;
+};
+
+//every engine that can be picked with --engine=
+const vector<string> lifeEngines = {"reference", "packed", "simd", "parallel", "hashlife", "sparse", "stream"};
+
+bool parseOptions(int argc, char* argv[], LifeOptions& options)
+{
+  bool engineGiven = false;
+  for(int i = 1; i < argc; i++)
+  {
+    string arg = argv[i];
+    if(arg.rfind("--engine=", 0) == 0)
+    {
+      options.engine = arg.substr(9);
+      engineGiven = true;
+    }
+    else if(arg.rfind("--isa=", 0) == 0)
+    {
+      life::Isa requested;
+      if(!life::parseIsa(arg.substr(6), requested))
+      {
+        cerr << "unknown instruction set: " << arg.substr(6) << endl;
+        return false;
+      }
+      //never go past what the CPU supports
+      options.isa = min(requested, options.isa);
+    }
+    else if(arg.rfind("--threads=", 0) == 0)
+    {
+      options.threads = atoi(arg.c_str() + 10);
+      if(options.threads < 1)
+      {
+        cerr << "thread count must be at least 1: " << arg << endl;
+        return false;
+      }
+    }
+    else if(arg.rfind("--rule=", 0) == 0)
+    {
+      if(!life::parseRule(arg.substr(7), options.rule))
+      {
+        cerr << "invalid rule, expected something like B36/S23: " << arg.substr(7) << endl;
+        return false;
+      }
+    }
+    else if(arg == "--stats")
+    {
+      options.stats = true;
+    }
+    else if(arg.rfind("--input=", 0) == 0)
+    {
+      options.input = arg.substr(8);
+    }
+    else if(arg.rfind("--output=", 0) == 0)
+    {
+      options.output = arg.substr(9);
+    }
+    else if(arg.rfind("--band-lines=", 0) == 0)
+    {
+      options.bandLines = atoi(arg.c_str() + 13);
+      if(options.bandLines < 1)
+      {
+        cerr << "band must have at least 1 line: " << arg << endl;
+        return false;
+      }
+    }
+    else if(arg == "--detect-period")
+    {
+      options.detectPeriod = true;
+    }
+    else if(arg == "--batch")
+    {
+      options.batch = true;
+    }
+    else if(arg == "--to-binary")
+    {
+      options.toBinary = true;
+    }
+    else if(arg == "--to-text")
+    {
+      options.toText = true;
+    }
+    else
+    {
+      cerr << "unknown option: " << arg << endl;
+      return false;
+    }
+  }
+
+  //the reference engine only knows its one global board, so batches default to the simd one
+  if(options.batch && !engineGiven)
+  {
+    options.engine = "simd";
+  }
+
+  if(find(lifeEngines.begin(), lifeEngines.end(), options.engine) == lifeEngines.end())
+  {
+    cerr << "unknown engine: " << options.engine << endl;
+    return false;
+  }
+  if(options.engine == "reference" && !(options.rule == life::conwayRule))
+  {
+    cerr << "the reference engine only runs B3/S23, pick another engine for "
+         << options.rule.toString() << endl;
+    return false;
+  }
+  if((!options.input.empty() || !options.output.empty()) && options.engine != "stream")
+  {
+    cerr << "--input and --output are only used by the stream engine" << endl;
+    return false;
+  }
+  if(options.detectPeriod && (options.engine == "reference" || options.engine == "hashlife" || options.engine == "stream"))
+  {
+    cerr << "--detect-period needs the packed, simd, parallel or sparse engine" << endl;
+    return false;
+  }
+  if(options.batch && (options.engine == "reference" || options.engine == "parallel" || options.engine == "stream"))
+  {
+    cerr << "--batch runs one board per thread, pick the packed, simd, sparse or hashlife engine" << endl;
+    return false;
+  }
+  return true;
+}
+
+//steps the bit-packed board, 64 cells per word, with one of the compiled rules of life_rule.h
+//the simd engine works on the same board, just with the widest vector kernel available
+//and the parallel engine splits it in bands of lines stepped on several threads
+//the sparse engine only recomputes the tiles around the ones that changed
+//stop is called after every generation with it and the previous one, and ends the run early
+//when it returns true; the sparse engine also reports every word it changed to wordChanged
+//returns the number of generations actually stepped
+template <class Rule, class Stop, class WordChanged>
+int advancePacked(PackedBoard& board, PackedBoard& scratch, int steps, const LifeOptions& options,
+                  const Rule& rule, life::SparseStepper& sparse, Stop&& stop, WordChanged&& wordChanged)
+{
+  if(options.engine == "parallel")
+  {
+    return life::stepParallel(board, scratch, steps, options.threads, options.isa, rule, stop);
+  }
+  for(int i = 0; i < steps; i++)
+  {
+    if(options.engine == "sparse")
+    {
+      sparse.step(board, scratch, rule, wordChanged);
+    }
+    else if(options.engine == "simd")
+    {
+      life::stepSimd(options.isa, board, scratch, rule);
+    }
+    else
+    {
+      life::step(board, scratch, rule);
+    }
+    if(stop(board, scratch))
+    {
+      return i + 1;
+    }
+  }
+  return steps;
+}
+
+//what a run of the packed engines did, for the statistics
+struct PackedRun
+{
+  //generations actually stepped, fewer than asked for once a period is found
+  int stepped = 0;
+  //0 when no period was found or looked for
+  long long period = 0, transient = 0;
+};
+
+template <class Rule>
+PackedRun stepPacked(PackedBoard& board, PackedBoard& scratch, int steps, const LifeOptions& options,
+                     const Rule& rule)
+{
+  PackedRun run;
+  life::SparseStepper sparse;
+  if(!options.detectPeriod)
+  {
+    run.stepped = advancePacked(board, scratch, steps, options, rule, sparse, life::NeverStop(), life::SparseStepper::IgnoreWords());
+  }
+  else
+  {
+    //every generation is hashed until one comes back, generation 0 being the input board
+    //the hash only follows the words that changed: the sparse engine reports them as it goes,
+    //for the others they are found by comparing with the previous generation
+    life::PeriodDetector detector;
+    life::BoardHash hash(board);
+    detector.record(board, hash.value());
+    bool reportsWords = options.engine == "sparse";
+    auto record = [&](const PackedBoard& generation, const PackedBoard& previous)
+    {
+      if(!reportsWords)
+      {
+        hash.update(generation, previous);
+      }
+      return detector.record(generation, hash.value());
+    };
+    auto wordChanged = [&](size_t index, uint64_t before, uint64_t after) { hash.change(index, before, after); };
+    run.stepped = advancePacked(board, scratch, steps, options, rule, sparse, record, wordChanged);
+    if(detector.found())
+    {
+      //from here the board repeats every period generations, so only the remainder is left to do
+      int left = int((steps - run.stepped) % detector.period());
+      run.stepped += advancePacked(board, scratch, left, options, rule, sparse, life::NeverStop(), life::SparseStepper::IgnoreWords());
+      run.period = detector.period();
+      run.transient = detector.transient();
+    }
+  }
+
+  if(options.engine == "sparse" && options.stats)
+  {
+    //how much of the board had to be recomputed, on average and at most
+    double generations = double(max<uint64_t>(1, sparse.generationsStepped()));
+    cerr << "sparse: " << sparse.tileCount() << " tiles, "
+         << double(sparse.activeTilesStepped()) / generations << " active per generation on average, "
+         << sparse.peakActiveTiles() << " at most" << endl;
+  }
+  return run;
+}
+
+//prints what the period detection found, if it was asked for
+void printPeriod(const PackedRun& run, int steps, const LifeOptions& options)
+{
+  if(!options.detectPeriod)
+  {
+    return;
+  }
+  if(run.period > 0)
+  {
+    cerr << "period: " << run.period << " after a transient of " << run.transient
+         << " generations, " << run.stepped << " of " << steps << " generations stepped";
+  }
+  else
+  {
+    cerr << "period: none within " << steps << " generations";
+  }
+}
+
+//runs the whole simulation on the bit-packed board
+//the hashlife engine jumps ahead in powers of two instead of stepping one generation at a time
+void runPacked(int columns, int lines, int steps, const LifeOptions& options)
+{
+  PackedBoard board(columns, lines), scratch(columns, lines);
+  life::readText(cin, board);
+
+  if(options.engine == "hashlife")
+  {
+    life::Hashlife hashlife(options.rule);
+    hashlife.advance(board, steps);
+    if(options.stats)
+    {
+      cerr << "hashlife: " << hashlife.nodeCount() << " nodes, " << hashlife.resultCount()
+           << " memoized results, " << hashlife.memoryBytes() / 1024 << " KiB" << endl;
+    }
+  }
+  else
+  {
+    //the rule is compiled once here, so the steppers never look at the rulestring again
+    PackedRun run = life::withRule(options.rule, [&](const auto& rule) {
+      return stepPacked(board, scratch, steps, options, rule);
+    });
+    if(options.stats && options.detectPeriod)
+    {
+      printPeriod(run, steps, options);
+      cerr << endl;
+    }
+  }
+
+  life::writeText(cout, board);
+}
+
+//what every batch worker keeps from one board to the next
+struct BatchWorker
+{
+  PackedBoard scratch;
+  //created on the first board and cleared for every next one, which keeps its allocations
+  unique_ptr<life::Hashlife> hashlife;
+};
+
+//steps every board of the input, one board per thread at a time
+//the boards come out in input order on stdout, and the time each one took on stderr
+bool runBatch(const LifeOptions& options)
+{
+  vector<life::BatchBoard> boards;
+  if(!life::readBatch(cin, boards))
+  {
+    cerr << "board " << boards.size() << " of the batch is incomplete" << endl;
+    return false;
+  }
+
+  //workers must not write to stderr in the middle of each other, so statistics wait for the end
+  LifeOptions boardOptions = options;
+  boardOptions.stats = false;
+  vector<BatchWorker> workers(options.threads);
+  vector<PackedRun> runs(boards.size());
+  vector<double> milliseconds(boards.size());
+
+  auto batchStart = chrono::steady_clock::now();
+  life::runWorkStealing(boards.size(), options.threads, [&](int worker, size_t index) {
+    BatchWorker& state = workers[worker];
+    life::BatchBoard& input = boards[index];
+    auto start = chrono::steady_clock::now();
+    if(options.engine == "hashlife")
+    {
+      if(!state.hashlife)
+      {
+        state.hashlife = make_unique<life::Hashlife>(options.rule);
+      }
+      state.hashlife->clear();
+      state.hashlife->advance(input.board, input.steps);
+      runs[index].stepped = input.steps;
+    }
+    else
+    {
+      runs[index] = life::withRule(options.rule, [&](const auto& rule) {
+        return stepPacked(input.board, state.scratch, input.steps, boardOptions, rule);
+      });
+    }
+    milliseconds[index] = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+  });
+
+  double wall = chrono::duration<double, milli>(chrono::steady_clock::now() - batchStart).count();
+
+  double total = 0;
+  for(size_t i = 0; i < boards.size(); i++)
+  {
+    const life::BatchBoard& output = boards[i];
+    life::writeText(cout, output.board);
+    cerr << "board " << i << ": " << output.board.columns << "x" << output.board.lines << ", "
+         << output.steps << " steps in " << milliseconds[i] << " ms";
+    if(options.detectPeriod)
+    {
+      cerr << ", ";
+      printPeriod(runs[i], output.steps, options);
+    }
+    cerr << "\n";
+    total += milliseconds[i];
+  }
+  cerr << "batch: " << boards.size() << " boards in " << wall << " ms, " << total
+       << " ms of stepping on " << min<size_t>(options.threads, max<size_t>(boards.size(), 1))
+       << " threads" << endl;
+  return true;
+}
+
+//steps a packed board file out of core, memory mapped and one band of lines at a time
+//text boards from stdin and to stdout go through temporary packed files
+bool runStream(const LifeOptions& options)
+{
+  string input = options.input, output = options.output;
+  if(input.empty())
+  {
+    input = life::makeTemporaryFile();
+    FILE* file = input.empty() ? nullptr : fopen(input.c_str(), "wb");
+    bool imported = file != nullptr && life::textToPacked(stdin, file);
+    if(file != nullptr)
+    {
+      imported = fclose(file) == 0 && imported;
+    }
+    if(!imported)
+    {
+      cerr << "cannot import the text board into a packed file" << endl;
+      return false;
+    }
+  }
+  if(output.empty())
+  {
+    output = life::makeTemporaryFile();
+  }
+
+  //16 generations per pass over the files
+  bool stepped = !output.empty() && life::withRule(options.rule, [&](const auto& rule) {
+    return life::stepPackedFile(input, output, options.bandLines, 16, options.isa, rule);
+  });
+  if(stepped && options.output.empty())
+  {
+    FILE* file = fopen(output.c_str(), "rb");
+    stepped = file != nullptr && life::packedToText(file, stdout, false);
+    if(file != nullptr)
+    {
+      fclose(file);
+    }
+  }
+
+  if(options.input.empty())
+  {
+    remove(input.c_str());
+  }
+  if(options.output.empty() && !output.empty())
+  {
+    remove(output.c_str());
+  }
+  return stepped;
+}
+
+int main(int argc, char* argv[]){
+  LifeOptions options;
+  if(!parseOptions(argc, argv, options))
+  {
+    return 1;
+  }
+
+  //format conversions and the stream engine never load the whole board, so they skip iostreams
+  if(options.toBinary)
+  {
+    return life::textToPacked(stdin, stdout) ? 0 : 1;
+  }
+  if(options.toText)
+  {
+    return life::packedToText(stdin, stdout, true) ? 0 : 1;
+  }
+  if(options.engine == "stream")
+  {
+    return runStream(options) ? 0 : 1;
+  }
+
+  //the text engines read and write a lot of single characters, so keep cin and cout unsynced
+  ios::sync_with_stdio(false);
+  cin.tie(nullptr);
+
+  if(options.batch)
+  {
+    return runBatch(options) ? 0 : 1;
+  }
+
   //start by defining variables for columns, lines, and number of steps
   int columns, lines, steps;
   //reading first 3 input values from test
   cin >> columns >> lines >> steps;
+
+  if(options.engine != "reference")
+  {
+    runPacked(columns, lines, steps, options);
+    return 0;
+  }
+
   //creating an empty gameboard
   gameBoard.resize(lines, vector<bool>(columns, false));
 
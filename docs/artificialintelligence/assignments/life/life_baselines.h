@@ -0,0 +1,103 @@
+#ifndef LIFE_BASELINES_H
+#define LIFE_BASELINES_H
+
+#include <vector>
+
+#include "life_packed.h"
+
+// The two straightforward steppers the packed engines are measured against: the reference engine
+// of life.cpp and the one of life_Tolsta.cpp. Both keep a vector<vector<bool>>, copy it every
+// generation and find the 8 neighbours of every cell through wrapped coordinates. They are kept
+// here in the same form, minus the global board, so the benchmark can time them without the
+// console input and output around them.
+namespace life {
+  using BoolBoard = std::vector<std::vector<bool>>;
+
+  inline BoolBoard toBoolBoard(const PackedBoard& board) {
+    BoolBoard cells(board.lines, std::vector<bool>(board.columns, false));
+    for (int y = 0; y < board.lines; y++)
+      for (int x = 0; x < board.columns; x++) cells[y][x] = board.get(x, y);
+    return cells;
+  }
+
+  inline PackedBoard toPackedBoard(const BoolBoard& cells) {
+    PackedBoard board(cells.empty() ? 0 : int(cells[0].size()), int(cells.size()));
+    for (int y = 0; y < board.lines; y++)
+      for (int x = 0; x < board.columns; x++)
+        if (cells[y][x]) board.set(x, y, true);
+    return board;
+  }
+
+  namespace reference {
+    struct Point {
+      int x, y;
+    };
+
+    inline Point north(Point p, Point limits) {
+      p.y--;
+      if (p.y < 0) p.y = limits.y - 1;
+      return p;
+    }
+    inline Point south(Point p, Point limits) {
+      p.y++;
+      p.y %= limits.y;
+      return p;
+    }
+    inline Point east(Point p, Point limits) {
+      p.x++;
+      p.x %= limits.x;
+      return p;
+    }
+    inline Point west(Point p, Point limits) {
+      p.x--;
+      if (p.x < 0) p.x = limits.x - 1;
+      return p;
+    }
+
+    inline int countNeighbours(const BoolBoard& board, Point p, Point limits) {
+      Point n = north(p, limits), s = south(p, limits);
+      Point neighbours[8] = {n, s, east(p, limits), west(p, limits),
+                             east(n, limits), west(n, limits), east(s, limits), west(s, limits)};
+      int count = 0;
+      for (Point q : neighbours)
+        if (board[q.y][q.x]) count++;
+      return count;
+    }
+
+    // One generation of life.cpp's step(): the new board starts as a copy of the current one.
+    inline void step(BoolBoard& board, Point limits) {
+      BoolBoard next = board;
+      for (int l = 0; l < limits.y; l++) {
+        for (int c = 0; c < limits.x; c++) {
+          int neighbours = countNeighbours(board, {c, l}, limits);
+          bool alive = board[l][c];
+          next[l][c] = alive ? neighbours == 2 || neighbours == 3 : neighbours == 3;
+        }
+      }
+      board = next;
+    }
+  }  // namespace reference
+
+  namespace tolsta {
+    // life_Tolsta.cpp walks the board the same way; it only differs in how the copy is made and
+    // in checking the three outcomes one after the other.
+    inline void step(BoolBoard& board, reference::Point limits) {
+      auto newBoard = board;
+      for (int l = 0; l < limits.y; l++) {
+        for (int c = 0; c < limits.x; c++) {
+          auto neighbours = reference::countNeighbours(board, {c, l}, limits);
+          auto isAlive = board[l][c];
+          if (isAlive && (neighbours == 2 || neighbours == 3))
+            newBoard[l][c] = true;
+          else if (!isAlive && neighbours == 3)
+            newBoard[l][c] = true;
+          else
+            newBoard[l][c] = false;
+        }
+      }
+      board = newBoard;
+    }
+  }  // namespace tolsta
+}  // namespace life
+
+#endif
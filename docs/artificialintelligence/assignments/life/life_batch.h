@@ -0,0 +1,87 @@
+#ifndef LIFE_BATCH_H
+#define LIFE_BATCH_H
+
+#include <algorithm>
+#include <cstddef>
+#include <istream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "life_packed.h"
+
+namespace life {
+  // One board of a batch, as read from the input, stepped in place.
+  struct BatchBoard {
+    PackedBoard board;
+    int steps = 0;
+  };
+
+  // Reads boards in the usual `columns lines steps` format one after the other until the end of
+  // the input. Returns false if something else than a board is found, or a header cut short.
+  inline bool readBatch(std::istream& in, std::vector<BatchBoard>& boards) {
+    int columns, lines, steps;
+    while (!(in >> std::ws).eof()) {
+      if (!(in >> columns >> lines >> steps) || columns < 0 || lines < 0) return false;
+      BatchBoard& next = boards.emplace_back();
+      next.board.resize(columns, lines);
+      next.steps = steps;
+      readText(in, next.board);
+      // a board cut short by the end of the input keeps its missing lines dead, like in a single
+      // run, but anything else that stops the read is an error
+      if (!in) return in.eof();
+    }
+    return true;
+  }
+
+  // Indices [front, back) still to be run by one worker. The owner takes them from the front and
+  // the other workers steal from the back, so both ends are rarely wanted at the same time.
+  struct alignas(64) WorkSlice {
+    std::mutex mutex;
+    size_t front = 0, back = 0;
+
+    bool popFront(size_t& index) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (front == back) return false;
+      index = front++;
+      return true;
+    }
+    bool stealBack(size_t& index) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (front == back) return false;
+      index = --back;
+      return true;
+    }
+  };
+
+  // Calls task(worker, index) for every index in [0, count) on `threads` workers. Every worker
+  // starts with a contiguous slice of the indices; once its own slice is done it steals from the
+  // others, so a few slow boards never leave the other workers idle. The calling thread is
+  // worker 0.
+  template <class Task> void runWorkStealing(size_t count, int threads, Task&& task) {
+    int workers = int(std::min<size_t>(size_t(std::max(threads, 1)), std::max<size_t>(count, 1)));
+    std::vector<WorkSlice> slices(workers);
+    for (int w = 0; w < workers; w++) {
+      slices[w].front = count * w / workers;
+      slices[w].back = count * (w + 1) / workers;
+    }
+
+    auto work = [&](int worker) {
+      size_t index;
+      while (slices[worker].popFront(index)) task(worker, index);
+      // nothing is ever added, so a slice found empty stays empty
+      for (int i = 1; i < workers; i++) {
+        WorkSlice& victim = slices[(worker + i) % workers];
+        while (victim.stealBack(index)) task(worker, index);
+      }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(workers - 1);
+    for (int w = 1; w < workers; w++) pool.emplace_back(work, w);
+    work(0);
+    for (auto& thread : pool) thread.join();
+  }
+}  // namespace life
+
+#endif
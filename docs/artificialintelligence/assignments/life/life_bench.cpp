@@ -0,0 +1,377 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "life_baselines.h"
+#include "life_hashlife.h"
+#include "life_packed.h"
+#include "life_parallel.h"
+#include "life_simd.h"
+#include "life_sparse.h"
+using namespace std;
+
+//benchmark of every life engine on generated boards, results printed as JSON on stdout
+//and progress on stderr, e.g. ai-life-bench --max-size=4096 > life-bench.json
+
+struct BenchOptions
+{
+  //smallest board every pattern fits on
+  static constexpr int patternSize = 16;
+  //boards go from minSize x minSize up to maxSize x maxSize, 4 times wider every time
+  int minSize = 64, maxSize = 16384;
+  //the vector<bool> baselines take seconds per generation on big boards, so they stop earlier
+  int baselineMaxSize = 1024;
+  //hashlife needs memory for every distinct square of a random board
+  int hashlifeMaxSize = 1024;
+  //every measure doubles its generations until it takes at least this long
+  double minSeconds = 0.25;
+  int maxGenerations = 1 << 16;
+  //the parallel engine is measured on 1, 2, 4, ... threads up to this many
+  int maxThreads = life::defaultThreadCount();
+  uint64_t seed = 1;
+  //engine names to run, all of them when empty
+  vector<string> engines;
+};
+
+struct BenchResult
+{
+  string engine, isa, pattern;
+  int threads = 1, columns = 0, lines = 0, generations = 0;
+  double seconds = 0;
+  size_t memoryBytes = 0;
+};
+
+bool parseBenchOptions(int argc, char* argv[], BenchOptions& options)
+{
+  for(int i = 1; i < argc; i++)
+  {
+    string arg = argv[i];
+    auto value = [&](const char* name) { return arg.substr(string(name).size()); };
+    if(arg.rfind("--min-size=", 0) == 0)
+    {
+      options.minSize = atoi(value("--min-size=").c_str());
+    }
+    else if(arg.rfind("--max-size=", 0) == 0)
+    {
+      options.maxSize = atoi(value("--max-size=").c_str());
+    }
+    else if(arg.rfind("--baseline-max-size=", 0) == 0)
+    {
+      options.baselineMaxSize = atoi(value("--baseline-max-size=").c_str());
+    }
+    else if(arg.rfind("--hashlife-max-size=", 0) == 0)
+    {
+      options.hashlifeMaxSize = atoi(value("--hashlife-max-size=").c_str());
+    }
+    else if(arg.rfind("--min-seconds=", 0) == 0)
+    {
+      options.minSeconds = atof(value("--min-seconds=").c_str());
+    }
+    else if(arg.rfind("--max-generations=", 0) == 0)
+    {
+      options.maxGenerations = atoi(value("--max-generations=").c_str());
+    }
+    else if(arg.rfind("--max-threads=", 0) == 0)
+    {
+      options.maxThreads = atoi(value("--max-threads=").c_str());
+    }
+    else if(arg.rfind("--seed=", 0) == 0)
+    {
+      options.seed = strtoull(value("--seed=").c_str(), nullptr, 10);
+    }
+    else if(arg.rfind("--engines=", 0) == 0)
+    {
+      stringstream list(value("--engines="));
+      string engine;
+      while(getline(list, engine, ','))
+      {
+        options.engines.push_back(engine);
+      }
+    }
+    else
+    {
+      cerr << "unknown option: " << arg << endl;
+      return false;
+    }
+  }
+  //the patterns are placed in 16x16 squares, the acorn in the middle of the board
+  if(options.minSize < BenchOptions::patternSize)
+  {
+    cerr << "--min-size must be at least " << BenchOptions::patternSize << ", the patterns need a board that wide" << endl;
+    return false;
+  }
+  if(options.maxSize < options.minSize || options.maxGenerations < 1
+     || options.maxThreads < 1 || options.minSeconds < 0)
+  {
+    cerr << "invalid benchmark settings" << endl;
+    return false;
+  }
+  return true;
+}
+
+//boards are generated from the seed, the pattern and the size only, so every run of the
+//benchmark, on any machine, steps exactly the same boards
+//random: every cell alive with a 25% chance
+//acorn: one acorn in the middle of an empty board, a methuselah that grows for 5206 generations
+//gliders: a glider in every 16x16 square, all flying the same way
+PackedBoard generateBoard(const string& pattern, int size, uint64_t seed)
+{
+  PackedBoard board(size, size);
+  if(pattern == "random")
+  {
+    mt19937_64 random(seed * 0x9E3779B97F4A7C15ull + uint64_t(size));
+    for(int y = 0; y < board.lines; y++)
+    {
+      uint64_t* row = board.row(y);
+      for(int w = 0; w < board.wordsPerRow; w++)
+      {
+        row[w] = random() & random();
+      }
+      row[board.wordsPerRow - 1] &= board.lastWordMask;
+    }
+  }
+  else if(pattern == "acorn")
+  {
+    int cells[7][2] = {{1, 0}, {3, 1}, {0, 2}, {1, 2}, {4, 2}, {5, 2}, {6, 2}};
+    for(auto& cell : cells)
+    {
+      board.set(size / 2 + cell[0], size / 2 + cell[1], true);
+    }
+  }
+  else
+  {
+    int cells[5][2] = {{1, 0}, {2, 1}, {0, 2}, {1, 2}, {2, 2}};
+    for(int y = 0; y + 16 <= size; y += 16)
+    {
+      for(int x = 0; x + 16 <= size; x += 16)
+      {
+        for(auto& cell : cells)
+        {
+          board.set(x + 6 + cell[0], y + 6 + cell[1], true);
+        }
+      }
+    }
+  }
+  return board;
+}
+
+//seconds taken by run(generations) on a fresh copy of the board, prepare() making that copy
+//outside of the measure
+double timeRun(const function<void()>& prepare, const function<void(int)>& run, int generations)
+{
+  prepare();
+  auto start = chrono::steady_clock::now();
+  run(generations);
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+//doubles the generations until a run takes at least minSeconds, and keeps the last run
+void measure(BenchResult& result, const BenchOptions& options, const function<void()>& prepare,
+             const function<void(int)>& run)
+{
+  int generations = 1;
+  double seconds = timeRun(prepare, run, generations);
+  while(seconds < options.minSeconds && generations < options.maxGenerations)
+  {
+    generations = min(generations * 2, options.maxGenerations);
+    seconds = timeRun(prepare, run, generations);
+  }
+  result.generations = generations;
+  result.seconds = seconds;
+}
+
+bool wanted(const BenchOptions& options, const string& engine)
+{
+  return options.engines.empty()
+         || find(options.engines.begin(), options.engines.end(), engine) != options.engines.end();
+}
+
+void printResult(ostream& out, const BenchResult& result)
+{
+  double cellUpdates = double(result.columns) * result.lines * result.generations;
+  out << "    {\"engine\": \"" << result.engine << "\", \"isa\": \"" << result.isa
+      << "\", \"threads\": " << result.threads << ", \"pattern\": \"" << result.pattern
+      << "\", \"columns\": " << result.columns << ", \"lines\": " << result.lines
+      << ", \"generations\": " << result.generations << ", \"seconds\": " << result.seconds
+      << ", \"cellUpdatesPerSecond\": " << (result.seconds > 0 ? cellUpdates / result.seconds : 0)
+      << ", \"memoryBytes\": " << result.memoryBytes << "}";
+}
+
+int main(int argc, char* argv[])
+{
+  BenchOptions options;
+  if(!parseBenchOptions(argc, argv, options))
+  {
+    return 1;
+  }
+
+  life::Isa detected = life::detectIsa();
+  vector<BenchResult> results;
+  auto report = [&](const BenchResult& result) {
+    results.push_back(result);
+    cerr << result.engine << " " << result.isa << " x" << result.threads << " " << result.pattern
+         << " " << result.columns << "x" << result.lines << ": " << result.generations
+         << " generations in " << result.seconds << " s" << endl;
+  };
+
+  for(int size = options.minSize; size <= options.maxSize; size *= 4)
+  {
+    for(string pattern : {"random", "acorn", "gliders"})
+    {
+      const PackedBoard initial = generateBoard(pattern, size, options.seed);
+      PackedBoard board, scratch;
+      size_t packedBytes = 2 * initial.words.size() * sizeof(uint64_t);
+      BenchResult base;
+      base.pattern = pattern;
+      base.columns = initial.columns;
+      base.lines = initial.lines;
+      base.isa = life::isaName(life::Isa::Scalar);
+      auto preparePacked = [&]() { board = initial; };
+
+      if(size <= options.baselineMaxSize)
+      {
+        //the board and the copy made every generation, at one bit per cell
+        size_t boolBytes = 2 * size_t(size) * (sizeof(vector<bool>) + (size_t(size) + 7) / 8);
+        life::BoolBoard cells;
+        life::reference::Point limits{size, size};
+        auto prepareBool = [&]() { cells = life::toBoolBoard(initial); };
+        if(wanted(options, "reference"))
+        {
+          BenchResult result = base;
+          result.engine = "reference";
+          result.memoryBytes = boolBytes;
+          measure(result, options, prepareBool, [&](int generations) {
+            for(int i = 0; i < generations; i++)
+            {
+              life::reference::step(cells, limits);
+            }
+          });
+          report(result);
+        }
+        if(wanted(options, "tolsta"))
+        {
+          BenchResult result = base;
+          result.engine = "tolsta";
+          result.memoryBytes = boolBytes;
+          measure(result, options, prepareBool, [&](int generations) {
+            for(int i = 0; i < generations; i++)
+            {
+              life::tolsta::step(cells, limits);
+            }
+          });
+          report(result);
+        }
+      }
+
+      if(wanted(options, "packed"))
+      {
+        BenchResult result = base;
+        result.engine = "packed";
+        result.memoryBytes = packedBytes;
+        measure(result, options, preparePacked, [&](int generations) {
+          for(int i = 0; i < generations; i++)
+          {
+            life::step(board, scratch);
+          }
+        });
+        report(result);
+      }
+
+      if(wanted(options, "simd"))
+      {
+        for(life::Isa isa = life::Isa::Sse2; isa <= detected; isa = life::Isa(int(isa) + 1))
+        {
+          BenchResult result = base;
+          result.engine = "simd";
+          result.isa = life::isaName(isa);
+          result.memoryBytes = packedBytes;
+          measure(result, options, preparePacked, [&](int generations) {
+            for(int i = 0; i < generations; i++)
+            {
+              life::stepSimd(isa, board, scratch);
+            }
+          });
+          report(result);
+        }
+      }
+
+      if(wanted(options, "parallel"))
+      {
+        //1, 2, 4, ... threads, and the largest count itself when it is not a power of two
+        vector<int> threadCounts;
+        for(int threads = 1; threads < options.maxThreads; threads *= 2)
+        {
+          threadCounts.push_back(threads);
+        }
+        threadCounts.push_back(options.maxThreads);
+        for(int threads : threadCounts)
+        {
+          BenchResult result = base;
+          result.engine = "parallel";
+          result.isa = life::isaName(detected);
+          result.threads = threads;
+          result.memoryBytes = packedBytes;
+          measure(result, options, preparePacked, [&](int generations) {
+            life::stepParallel(board, scratch, generations, threads, detected);
+          });
+          report(result);
+        }
+      }
+
+      if(wanted(options, "sparse"))
+      {
+        BenchResult result = base;
+        result.engine = "sparse";
+        life::SparseStepper sparse;
+        measure(result, options, [&]() {
+          board = initial;
+          sparse = life::SparseStepper();
+        }, [&](int generations) {
+          for(int i = 0; i < generations; i++)
+          {
+            sparse.step(board, scratch);
+          }
+        });
+        //3 bytes of flags per tile on top of the two boards
+        result.memoryBytes = packedBytes + 3 * size_t(sparse.tileCount());
+        report(result);
+      }
+
+      if(wanted(options, "hashlife") && size <= options.hashlifeMaxSize)
+      {
+        BenchResult result = base;
+        result.engine = "hashlife";
+        life::Hashlife hashlife;
+        measure(result, options, [&]() {
+          board = initial;
+          hashlife.clear();
+        }, [&](int generations) {
+          hashlife.advance(board, generations);
+        });
+        result.memoryBytes = packedBytes / 2 + hashlife.memoryBytes();
+        report(result);
+      }
+    }
+  }
+
+  cout << "{\n  \"machine\": {\"isa\": \"" << life::isaName(detected)
+       << "\", \"hardwareThreads\": " << life::defaultThreadCount() << "},\n"
+       << "  \"settings\": {\"seed\": " << options.seed
+       << ", \"minSeconds\": " << options.minSeconds
+       << ", \"maxGenerations\": " << options.maxGenerations << "},\n"
+       << "  \"results\": [\n";
+  for(size_t i = 0; i < results.size(); i++)
+  {
+    printResult(cout, results[i]);
+    cout << (i + 1 < results.size() ? ",\n" : "\n");
+  }
+  cout << "  ]\n}\n";
+  return 0;
+}
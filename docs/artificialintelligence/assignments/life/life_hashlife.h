@@ -0,0 +1,237 @@
+#ifndef LIFE_HASHLIFE_H
+#define LIFE_HASHLIFE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "life_packed.h"
+
+namespace life {
+  // Hashlife: the universe is a quadtree whose nodes are hash-consed, so equal squares share one
+  // node, and the future of every node is memoized. A node of level k is a square of 2^k cells and
+  // its result after 2^j generations (j <= k - 2) is its centre square of level k - 1.
+  //
+  // The board is a torus, which is the same as the infinite plane tiled with copies of the board.
+  // To advance by 2^j generations, a square of that tiled plane large enough to hold the whole
+  // board in its centre is built, and the board is read back from the centre of the result. Since
+  // the tiling is periodic, a level never holds more distinct nodes than the board has cells.
+  class Hashlife {
+  public:
+    explicit Hashlife(const LifeRule& rule = LifeRule()) : rule(rule) {}
+
+    // Advances the board `steps` generations, one power of two at a time.
+    void advance(PackedBoard& board, int64_t steps) {
+      for (int j = 0; (steps >> j) != 0; j++)
+        if ((steps >> j) & 1) advancePowerOfTwo(board, j);
+    }
+
+    size_t nodeCount() const { return nodes.size(); }
+    size_t resultCount() const { return results.size(); }
+
+    // Approximate bytes held by the node store, the hash-consing table and the result memo.
+    size_t memoryBytes() const {
+      size_t nodeBytes = nodes.capacity() * sizeof(Node);
+      size_t uniqueBytes = unique.size() * (sizeof(Node) + sizeof(uint32_t) + 2 * sizeof(void*))
+                           + unique.bucket_count() * sizeof(void*);
+      size_t resultBytes
+          = results.size() * (sizeof(uint64_t) + sizeof(uint32_t) + 2 * sizeof(void*))
+            + results.bucket_count() * sizeof(void*);
+      return nodeBytes + uniqueBytes + resultBytes;
+    }
+
+    // Drops every node and memoized result.
+    void clear() {
+      nodes.clear();
+      unique.clear();
+      results.clear();
+      emptyNodes.clear();
+    }
+
+  private:
+    // Children of a node; nodes 0 and 1 are the dead and the alive cell.
+    struct Node {
+      uint32_t nw, ne, sw, se;
+      bool operator==(const Node& other) const {
+        return nw == other.nw && ne == other.ne && sw == other.sw && se == other.se;
+      }
+    };
+
+    struct NodeHash {
+      size_t operator()(const Node& node) const {
+        uint64_t h = (uint64_t(node.nw) << 32 | node.ne) * 0x9E3779B97F4A7C15ull;
+        h ^= (uint64_t(node.sw) << 32 | node.se) + 0x632BE59BD9B4E019ull + (h << 6) + (h >> 2);
+        return size_t(h ^ (h >> 29));
+      }
+    };
+
+    // Memory is given back once a run has created this many nodes.
+    static constexpr size_t maxNodes = size_t{1} << 26;
+
+    LifeRule rule;
+    std::vector<Node> nodes;
+    std::unordered_map<Node, uint32_t, NodeHash> unique;
+    std::unordered_map<uint64_t, uint32_t> results;
+    std::vector<uint32_t> emptyNodes;
+    // nodes built from the board for the current power of two, keyed by level and position
+    std::unordered_map<uint64_t, uint32_t> built;
+
+    void ensureLeaves() {
+      if (!nodes.empty()) return;
+      nodes.push_back({0, 0, 0, 0});
+      nodes.push_back({0, 0, 0, 0});
+      emptyNodes.push_back(0);
+    }
+
+    uint32_t join(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se) {
+      Node node{nw, ne, sw, se};
+      auto found = unique.find(node);
+      if (found != unique.end()) return found->second;
+      auto id = uint32_t(nodes.size());
+      nodes.push_back(node);
+      unique.emplace(node, id);
+      return id;
+    }
+
+    uint32_t empty(int level) {
+      while (int(emptyNodes.size()) <= level) {
+        uint32_t e = emptyNodes.back();
+        emptyNodes.push_back(join(e, e, e, e));
+      }
+      return emptyNodes[level];
+    }
+
+    // Squares of level - 1 that straddle two or four children of a node.
+    uint32_t horizontal(uint32_t w, uint32_t e) {
+      return join(nodes[w].ne, nodes[e].nw, nodes[w].se, nodes[e].sw);
+    }
+    uint32_t vertical(uint32_t n, uint32_t s) {
+      return join(nodes[n].sw, nodes[n].se, nodes[s].nw, nodes[s].ne);
+    }
+    uint32_t centre(uint32_t id) {
+      const Node& node = nodes[id];
+      return join(nodes[node.nw].se, nodes[node.ne].sw, nodes[node.sw].ne, nodes[node.se].nw);
+    }
+
+    // Cell (x, y) of a level 2 node.
+    bool cell(uint32_t id, int x, int y) const {
+      const Node& node = nodes[id];
+      uint32_t quadrant = y < 2 ? (x < 2 ? node.nw : node.ne) : (x < 2 ? node.sw : node.se);
+      const Node& leaves = nodes[quadrant];
+      x &= 1;
+      y &= 1;
+      return (y == 0 ? (x == 0 ? leaves.nw : leaves.ne) : (x == 0 ? leaves.sw : leaves.se)) != 0;
+    }
+
+    // Centre 2x2 of a 4x4 node after one generation.
+    uint32_t stepLevel2(uint32_t id) {
+      uint32_t next[4];
+      for (int i = 0; i < 4; i++) {
+        int x = 1 + (i & 1), y = 1 + (i >> 1);
+        int count = 0;
+        for (int dy = -1; dy <= 1; dy++)
+          for (int dx = -1; dx <= 1; dx++)
+            if ((dx != 0 || dy != 0) && cell(id, x + dx, y + dy)) count++;
+        bool alive = cell(id, x, y);
+        next[i] = rule.next(alive, count) ? 1 : 0;
+      }
+      return join(next[0], next[1], next[2], next[3]);
+    }
+
+    // Centre of a node of the given level after 2^j generations, j <= level - 2.
+    uint32_t nextGeneration(uint32_t id, int level, int j) {
+      // empty space stays empty, unless the rule gives birth to cells with no neighbours
+      if ((rule.birth & 1) == 0 && id == empty(level)) return empty(level - 1);
+      if (level == 2) return stepLevel2(id);
+
+      uint64_t key = uint64_t(id) << 6 | uint64_t(j);
+      auto found = results.find(key);
+      if (found != results.end()) return found->second;
+
+      // nine overlapping squares of level - 1 ...
+      Node node = nodes[id];
+      uint32_t squares[9] = {node.nw,
+                             horizontal(node.nw, node.ne),
+                             node.ne,
+                             vertical(node.nw, node.sw),
+                             centre(id),
+                             vertical(node.ne, node.se),
+                             node.sw,
+                             horizontal(node.sw, node.se),
+                             node.se};
+
+      // ... reduced to their centres, advanced by half the step when going at full speed
+      bool fullSpeed = j == level - 2;
+      uint32_t inner[9];
+      for (int i = 0; i < 9; i++) {
+        inner[i] = fullSpeed ? nextGeneration(squares[i], level - 1, level - 3)
+                             : centre(squares[i]);
+      }
+
+      // ... then regrouped in four squares that are advanced by the rest of the step
+      int rest = fullSpeed ? level - 3 : j;
+      uint32_t nw = nextGeneration(join(inner[0], inner[1], inner[3], inner[4]), level - 1, rest);
+      uint32_t ne = nextGeneration(join(inner[1], inner[2], inner[4], inner[5]), level - 1, rest);
+      uint32_t sw = nextGeneration(join(inner[3], inner[4], inner[6], inner[7]), level - 1, rest);
+      uint32_t se = nextGeneration(join(inner[4], inner[5], inner[7], inner[8]), level - 1, rest);
+      uint32_t result = join(nw, ne, sw, se);
+      results.emplace(key, result);
+      return result;
+    }
+
+    // Node of the given level whose top left cell is cell (x, y) of the board, tiled forever.
+    uint32_t build(const PackedBoard& board, int level, int64_t x, int64_t y) {
+      if (level == 0) return board.get(int(x), int(y)) ? 1 : 0;
+      uint64_t key = (uint64_t(y) * uint64_t(board.columns) + uint64_t(x)) << 6 | uint64_t(level);
+      auto found = built.find(key);
+      if (found != built.end()) return found->second;
+
+      int64_t half = int64_t{1} << (level - 1);
+      int64_t east = (x + half) % board.columns, south = (y + half) % board.lines;
+      uint32_t id = join(build(board, level - 1, x, y), build(board, level - 1, east, y),
+                         build(board, level - 1, x, south), build(board, level - 1, east, south));
+      built.emplace(key, id);
+      return id;
+    }
+
+    // Writes the cells of a node lying inside the board, (x, y) being the node's top left cell.
+    void extract(uint32_t id, int level, int64_t x, int64_t y, PackedBoard& board) {
+      if (x >= board.columns || y >= board.lines || id == empty(level)) return;
+      if (level == 0) {
+        board.set(int(x), int(y), true);
+        return;
+      }
+      int64_t half = int64_t{1} << (level - 1);
+      Node node = nodes[id];
+      extract(node.nw, level - 1, x, y, board);
+      extract(node.ne, level - 1, x + half, y, board);
+      extract(node.sw, level - 1, x, y + half, board);
+      extract(node.se, level - 1, x + half, y + half, board);
+    }
+
+    void advancePowerOfTwo(PackedBoard& board, int j) {
+      if (board.columns == 0 || board.lines == 0) return;
+      if (nodes.size() > maxNodes) clear();
+      ensureLeaves();
+
+      // the centre of the result, of level k - 1, has to cover the whole board
+      int boardLevel = 1;
+      while ((int64_t{1} << boardLevel) < std::max(board.columns, board.lines)) boardLevel++;
+      int level = std::max(j + 2, boardLevel + 1);
+
+      // the centre starts 2^(k - 2) cells in, and that is where cell (0, 0) of the board goes
+      int64_t origin = int64_t{1} << (level - 2);
+      int64_t x = (board.columns - origin % board.columns) % board.columns;
+      int64_t y = (board.lines - origin % board.lines) % board.lines;
+      uint32_t root = build(board, level, x, y);
+      built.clear();
+
+      uint32_t result = nextGeneration(root, level, j);
+      std::fill(board.words.begin(), board.words.end(), 0);
+      extract(result, level - 1, 0, 0, board);
+    }
+  };
+}  // namespace life
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef LIFE_PACKED_H
+#define LIFE_PACKED_H
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "life_rule.h"
+
+// Board that packs every row into 64-bit words: bit i of word w is the cell on column w * 64 + i.
+// The bits past the last column of a row are always kept dead, so whole words can be compared,
+// hashed or copied without masking.
+struct PackedBoard {
+  int columns = 0;
+  int lines = 0;
+  int wordsPerRow = 0;
+  uint64_t lastWordMask = 0;
+  std::vector<uint64_t> words;
+
+  PackedBoard() = default;
+  PackedBoard(int columns, int lines) { resize(columns, lines); }
+
+  void resize(int newColumns, int newLines) {
+    columns = newColumns;
+    lines = newLines;
+    wordsPerRow = (columns + 63) / 64;
+    int tail = columns % 64;
+    lastWordMask = tail == 0 ? ~uint64_t{0} : (uint64_t{1} << tail) - 1;
+    words.assign(size_t(wordsPerRow) * size_t(lines), 0);
+  }
+
+  uint64_t* row(int y) { return words.data() + size_t(y) * wordsPerRow; }
+  const uint64_t* row(int y) const { return words.data() + size_t(y) * wordsPerRow; }
+
+  bool get(int x, int y) const { return (row(y)[x >> 6] >> (x & 63)) & 1; }
+  void set(int x, int y, bool alive) {
+    uint64_t bit = uint64_t{1} << (x & 63);
+    if (alive)
+      row(y)[x >> 6] |= bit;
+    else
+      row(y)[x >> 6] &= ~bit;
+  }
+
+  bool operator==(const PackedBoard& other) const {
+    return columns == other.columns && lines == other.lines && words == other.words;
+  }
+};
+
+namespace life {
+  // Bit planes of the 0..8 live neighbour count of 64 cells: count = s0 + 2 s1 + 4 s2 + 8 s3.
+  struct NeighbourCount {
+    uint64_t s0, s1, s2, s3;
+  };
+
+  // Adds the 8 neighbour words with full adders, one adder per bit lane. This and the shifts below
+  // sit in the inner loop of every engine and are forced inline: with one stepper per rule in the
+  // program, the compiler would otherwise run out of inlining budget and call them.
+  LIFE_ALWAYS_INLINE NeighbourCount countNeighbours(uint64_t nw, uint64_t n, uint64_t ne,
+                                                    uint64_t w, uint64_t e, uint64_t sw,
+                                                    uint64_t s, uint64_t se) {
+    // every row collapses into a 2-bit partial sum
+    uint64_t upXor = nw ^ n;
+    uint64_t up0 = upXor ^ ne, up1 = (nw & n) | (ne & upXor);
+    uint64_t mid0 = w ^ e, mid1 = w & e;
+    uint64_t downXor = sw ^ s;
+    uint64_t down0 = downXor ^ se, down1 = (sw & s) | (se & downXor);
+
+    // then the three partial sums are added together
+    uint64_t onesXor = up0 ^ mid0;
+    uint64_t s0 = onesXor ^ down0;
+    uint64_t carry = (up0 & mid0) | (down0 & onesXor);
+    uint64_t twosXor = up1 ^ mid1;
+    uint64_t twos = twosXor ^ down1;
+    uint64_t fours = (up1 & mid1) | (down1 & twosXor);
+    uint64_t s1 = twos ^ carry;
+    uint64_t foursFromCarry = twos & carry;
+    return {s0, s1, fours ^ foursFromCarry, fours & foursFromCarry};
+  }
+
+  // Word w of a row shifted so that every bit holds its western (column - 1) neighbour.
+  LIFE_ALWAYS_INLINE uint64_t westOf(const uint64_t* r, int w, const PackedBoard& board) {
+    uint64_t carry = w > 0 ? r[w - 1] >> 63
+                           : (r[board.wordsPerRow - 1] >> ((board.columns - 1) & 63)) & 1;
+    return (r[w] << 1) | carry;
+  }
+
+  // Word w of a row shifted so that every bit holds its eastern (column + 1) neighbour.
+  LIFE_ALWAYS_INLINE uint64_t eastOf(const uint64_t* r, int w, const PackedBoard& board) {
+    if (w + 1 < board.wordsPerRow) return (r[w] >> 1) | (r[w + 1] << 63);
+    return (r[w] >> 1) | ((r[0] & 1) << ((board.columns - 1) & 63));
+  }
+
+  inline int lineAbove(int y, int lines) { return y == 0 ? lines - 1 : y - 1; }
+  inline int lineBelow(int y, int lines) { return y + 1 == lines ? 0 : y + 1; }
+
+  // Computes the words [firstWord, lastWord) of line y of the next generation. Rule is one of the
+  // bit-sliced rules of life_rule.h; every stepper below takes one and defaults to Conway.
+  template <class Rule = ConwayRule>
+  inline void stepWords(const PackedBoard& current, PackedBoard& next, int y, int firstWord,
+                        int lastWord, const Rule& rule = Rule()) {
+    const uint64_t* up = current.row(lineAbove(y, current.lines));
+    const uint64_t* mid = current.row(y);
+    const uint64_t* down = current.row(lineBelow(y, current.lines));
+    uint64_t* out = next.row(y);
+    for (int w = firstWord; w < lastWord; w++) {
+      auto count = countNeighbours(westOf(up, w, current), up[w], eastOf(up, w, current),
+                                   westOf(mid, w, current), eastOf(mid, w, current),
+                                   westOf(down, w, current), down[w], eastOf(down, w, current));
+      out[w] = rule.apply(count.s0, count.s1, count.s2, count.s3, mid[w]);
+    }
+    if (lastWord == current.wordsPerRow && lastWord > 0) out[lastWord - 1] &= current.lastWordMask;
+  }
+
+  // Computes the lines [firstLine, lastLine) of the next generation.
+  template <class Rule = ConwayRule>
+  inline void stepLines(const PackedBoard& current, PackedBoard& next, int firstLine, int lastLine,
+                        const Rule& rule = Rule()) {
+    for (int y = firstLine; y < lastLine; y++)
+      stepWords(current, next, y, 0, current.wordsPerRow, rule);
+  }
+
+  // Advances the board one generation. `scratch` is reused as the back buffer and swapped in,
+  // so no memory is allocated once both boards have the same size.
+  template <class Rule = ConwayRule>
+  inline void step(PackedBoard& board, PackedBoard& scratch, const Rule& rule = Rule()) {
+    if (scratch.columns != board.columns || scratch.lines != board.lines)
+      scratch.resize(board.columns, board.lines);
+    stepLines(board, scratch, 0, board.lines, rule);
+    std::swap(board.words, scratch.words);
+  }
+
+  // Reads `lines` rows of `#`/`.` characters into the board.
+  inline void readText(std::istream& in, PackedBoard& board) {
+    std::string line;
+    for (int y = 0; y < board.lines; y++) {
+      in >> line;
+      uint64_t* r = board.row(y);
+      int length = std::min<int>(board.columns, int(line.size()));
+      for (int x = 0; x < length; x++)
+        if (line[x] == '#') r[x >> 6] |= uint64_t{1} << (x & 63);
+    }
+  }
+
+  // Writes the board in the same `#`/`.` format, one buffered write per row.
+  inline void writeText(std::ostream& out, const PackedBoard& board) {
+    std::string line(size_t(board.columns) + 1, '\n');
+    for (int y = 0; y < board.lines; y++) {
+      const uint64_t* r = board.row(y);
+      for (int x = 0; x < board.columns; x++) line[x] = (r[x >> 6] >> (x & 63)) & 1 ? '#' : '.';
+      out.write(line.data(), std::streamsize(line.size()));
+    }
+  }
+}  // namespace life
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef LIFE_PARALLEL_H
+#define LIFE_PARALLEL_H
+
+#include <algorithm>
+#include <barrier>
+#include <exception>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "life_packed.h"
+#include "life_simd.h"
+
+namespace life {
+  // Number of threads used when none is asked for.
+  inline int defaultThreadCount() { return std::max(1u, std::thread::hardware_concurrency()); }
+
+  // Lines [first, last) of the band owned by thread `band` out of `bands`.
+  inline std::pair<int, int> bandLines(int lines, int band, int bands) {
+    return {int(int64_t(lines) * band / bands), int(int64_t(lines) * (band + 1) / bands)};
+  }
+
+  // Stop condition that lets stepParallel run every generation.
+  struct NeverStop {
+    bool operator()(const PackedBoard&, const PackedBoard&) const { return false; }
+  };
+
+  // Advances the board `steps` generations on `threads` threads. The torus is cut into horizontal
+  // bands, one per thread, and every thread writes its band of the back buffer while reading the
+  // front one. The halo lines a band needs from its neighbours are read straight from the front
+  // buffer, so the only synchronisation is one barrier per generation, whose completion swaps the
+  // two buffers.
+  //
+  // With a stop condition, the calling thread then calls stop() with the new generation and the
+  // previous one while the other threads wait at a second barrier, and every thread leaves early
+  // once it returns true. stop() runs outside the barrier completion, which must not throw, so it
+  // may allocate; an exception it throws ends the run and is rethrown once the threads are joined.
+  // Returns the number of generations run.
+  template <class Rule = ConwayRule, class Stop = NeverStop>
+  inline int stepParallel(PackedBoard& board, PackedBoard& scratch, int steps, int threads,
+                          Isa isa, const Rule& rule = Rule(), Stop&& stop = Stop()) {
+    constexpr bool stops = !std::is_same_v<std::decay_t<Stop>, NeverStop>;
+    if (steps <= 0 || board.lines == 0) return 0;
+    if (scratch.columns != board.columns || scratch.lines != board.lines)
+      scratch.resize(board.columns, board.lines);
+    threads = std::clamp(threads, 1, board.lines);
+
+    PackedBoard* current = &board;
+    PackedBoard* next = &scratch;
+    int generations = 0;
+    bool stopped = false;
+    std::exception_ptr failure;
+    auto finishGeneration = [&]() noexcept {
+      std::swap(current, next);
+      generations++;
+    };
+    std::barrier generationDone(threads, finishGeneration);
+    std::barrier stopChecked(threads);
+
+    auto stepBand = [&](int band) {
+      auto [firstLine, lastLine] = bandLines(board.lines, band, threads);
+      for (int i = 0; i < steps && !stopped; i++) {
+        stepLinesSimd(isa, *current, *next, firstLine, lastLine, rule);
+        generationDone.arrive_and_wait();
+        if constexpr (stops) {
+          if (band == 0) {
+            try {
+              stopped = stop(*current, *next);
+            } catch (...) {
+              failure = std::current_exception();
+              stopped = true;
+            }
+          }
+          stopChecked.arrive_and_wait();
+        }
+      }
+    };
+
+    // the calling thread works on the first band instead of waiting idle
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (int band = 1; band < threads; band++) pool.emplace_back(stepBand, band);
+    stepBand(0);
+    for (auto& thread : pool) thread.join();
+
+    if (current != &board) std::swap(board.words, scratch.words);
+    if (failure) std::rethrow_exception(failure);
+    return generations;
+  }
+}  // namespace life
+
+#endif
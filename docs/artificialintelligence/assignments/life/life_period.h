@@ -0,0 +1,114 @@
+#ifndef LIFE_PERIOD_H
+#define LIFE_PERIOD_H
+
+#include <cstdint>
+#include <unordered_map>
+
+#include "life_packed.h"
+
+namespace life {
+  // Zobrist-style hash of one word of a board: an independent, well mixed term per position and
+  // value. The hash of a board is the XOR of the terms of all its words, so changing one word
+  // only changes its own term.
+  LIFE_ALWAYS_INLINE uint64_t wordHash(size_t index, uint64_t word) {
+    uint64_t h = word ^ (uint64_t(index) * 0x9E3779B97F4A7C15ull);
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    return h ^ (h >> 33);
+  }
+
+  inline uint64_t hashBoard(const PackedBoard& board) {
+    uint64_t hash = 0;
+    for (size_t i = 0; i < board.words.size(); i++) hash ^= wordHash(i, board.words[i]);
+    return hash;
+  }
+
+  // Hash of a board kept up to date from the words that change between generations, instead of
+  // hashing the whole board again every generation.
+  class BoardHash {
+  public:
+    explicit BoardHash(const PackedBoard& board) : hash(hashBoard(board)) {}
+
+    uint64_t value() const { return hash; }
+
+    // Word `index` went from `before` to `after`.
+    LIFE_ALWAYS_INLINE void change(size_t index, uint64_t before, uint64_t after) {
+      hash ^= wordHash(index, before) ^ wordHash(index, after);
+    }
+
+    // For the steppers that rewrite every word: the changed words are found by comparing the
+    // new generation with the previous one, and only those are hashed again.
+    void update(const PackedBoard& board, const PackedBoard& previous) {
+      const uint64_t* now = board.words.data();
+      const uint64_t* before = previous.words.data();
+      for (size_t i = 0; i < board.words.size(); i++)
+        if (now[i] != before[i]) change(i, before[i], now[i]);
+    }
+
+  private:
+    uint64_t hash;
+  };
+
+  // Finds the generation from which a board repeats. Every generation is hashed and remembered;
+  // when a hash comes back, the board is copied and compared for real one period later, so a hash
+  // collision can delay the detection but never report a wrong period.
+  class PeriodDetector {
+  public:
+    // Past `maxHistory` remembered generations the history starts over, which keeps finding
+    // periods but may report a transient that is longer than the real one.
+    explicit PeriodDetector(size_t maxHistory = size_t{1} << 20) : maxHistory(maxHistory) {}
+
+    // Records the next generation of the board, the first call being generation 0. Returns true
+    // once the board is known to repeat, from then on every generation is the one `period()`
+    // generations before.
+    bool record(const PackedBoard& board) { return record(board, hashBoard(board)); }
+
+    // The same with the hash of the board already known, see BoardHash.
+    bool record(const PackedBoard& board, uint64_t hash) {
+      int64_t generation = generations++;
+      if (found()) return true;
+
+      if (candidateGeneration >= 0) {
+        if (generation - candidateGeneration < candidatePeriod) return false;
+        if (board == candidate) {
+          foundPeriod = candidatePeriod;
+          foundTransient = candidateFirst;
+          return true;
+        }
+        candidateGeneration = -1;
+      }
+
+      auto [seenAt, inserted] = seen.emplace(hash, generation);
+      if (!inserted) {
+        candidateFirst = seenAt->second;
+        candidatePeriod = generation - candidateFirst;
+        candidateGeneration = generation;
+        candidate = board;
+      } else if (seen.size() > maxHistory) {
+        seen.clear();
+      }
+      return false;
+    }
+
+    bool found() const { return foundPeriod > 0; }
+    // 1 for a still life, p for an oscillator of period p, 0 if no period was found yet.
+    int64_t period() const { return foundPeriod; }
+    // First generation of the cycle.
+    int64_t transient() const { return foundTransient; }
+    // Number of generations recorded, generation 0 included.
+    int64_t recorded() const { return generations; }
+
+  private:
+    size_t maxHistory;
+    std::unordered_map<uint64_t, int64_t> seen;
+    int64_t generations = 0;
+    int64_t foundPeriod = 0, foundTransient = 0;
+    // board whose hash came back, waiting for the generation that should repeat it
+    PackedBoard candidate;
+    int64_t candidateGeneration = -1, candidateFirst = 0, candidatePeriod = 0;
+  };
+}  // namespace life
+
+#endif
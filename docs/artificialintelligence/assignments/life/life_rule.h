@@ -0,0 +1,167 @@
+#ifndef LIFE_RULE_H
+#define LIFE_RULE_H
+
+#include <cctype>
+#include <cstdint>
+#include <string>
+
+#if defined(__GNUC__) || defined(__clang__)
+#  define LIFE_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#  define LIFE_ALWAYS_INLINE inline
+#endif
+
+// Life-like rule in B/S notation: bit n of `birth` is set when a dead cell with n live neighbours
+// comes alive, and bit n of `survival` when a live cell with n live neighbours stays alive.
+// The default is Conway's B3/S23.
+struct LifeRule {
+  uint16_t birth = 1 << 3;
+  uint16_t survival = 1 << 2 | 1 << 3;
+
+  bool next(bool alive, int neighbours) const {
+    return (((alive ? survival : birth) >> neighbours) & 1) != 0;
+  }
+
+  constexpr bool operator==(const LifeRule& other) const {
+    return birth == other.birth && survival == other.survival;
+  }
+
+  std::string toString() const {
+    std::string text = "B";
+    for (int n = 0; n <= 8; n++)
+      if ((birth >> n) & 1) text += char('0' + n);
+    text += "/S";
+    for (int n = 0; n <= 8; n++)
+      if ((survival >> n) & 1) text += char('0' + n);
+    return text;
+  }
+};
+
+namespace life {
+  // Rules we run often enough to give them a name and a compile-time specialization.
+  constexpr LifeRule conwayRule{};
+  constexpr LifeRule highLifeRule{1 << 3 | 1 << 6, 1 << 2 | 1 << 3};
+  constexpr LifeRule seedsRule{1 << 2, 0};
+  constexpr LifeRule dayAndNightRule{1 << 3 | 1 << 6 | 1 << 7 | 1 << 8,
+                                     1 << 3 | 1 << 4 | 1 << 6 | 1 << 7 | 1 << 8};
+
+  // Reads a rulestring such as B36/S23 (any case, in either order) or one of the names
+  // conway, highlife, seeds and daynight.
+  inline bool parseRule(const std::string& text, LifeRule& rule) {
+    if (text == "conway")
+      rule = conwayRule;
+    else if (text == "highlife")
+      rule = highLifeRule;
+    else if (text == "seeds")
+      rule = seedsRule;
+    else if (text == "daynight")
+      rule = dayAndNightRule;
+    else {
+      LifeRule parsed{0, 0};
+      bool seenBirth = false, seenSurvival = false;
+      uint16_t* counts = nullptr;
+      for (char c : text) {
+        char upper = char(std::toupper(static_cast<unsigned char>(c)));
+        if (upper == 'B' && !seenBirth) {
+          counts = &parsed.birth;
+          seenBirth = true;
+        } else if (upper == 'S' && !seenSurvival) {
+          counts = &parsed.survival;
+          seenSurvival = true;
+        } else if (c >= '0' && c <= '8' && counts != nullptr) {
+          *counts |= uint16_t(1 << (c - '0'));
+        } else if (c != '/') {
+          return false;
+        }
+      }
+      if (!seenBirth || !seenSurvival) return false;
+      rule = parsed;
+    }
+    return true;
+  }
+
+  // Bit-sliced rules. apply() gets the four bit planes of the neighbour count (count = s0 + 2 s1 +
+  // 4 s2 + 8 s3) and the current cells, and returns the next cells. Only &, | and ~ are used, so
+  // the same code runs on 64-bit words and on SSE/AVX registers.
+
+  // Cells whose neighbour count is exactly n.
+  template <class T> LIFE_ALWAYS_INLINE T countIs(int n, T s0, T s1, T s2, T s3) {
+    return (n & 1 ? s0 : ~s0) & (n & 2 ? s1 : ~s1) & (n & 4 ? s2 : ~s2) & (n & 8 ? s3 : ~s3);
+  }
+
+  // Rule known at compile time: once the loop is unrolled the compiler folds away every count
+  // the rule ignores.
+  template <uint16_t Birth, uint16_t Survival> struct FixedRule {
+    template <class T> LIFE_ALWAYS_INLINE T apply(T s0, T s1, T s2, T s3, T alive) const {
+      T next = alive & ~alive;
+      for (int n = 0; n <= 8; n++) {
+        bool born = (Birth >> n) & 1, survives = (Survival >> n) & 1;
+        if (!born && !survives) continue;
+        T cells = countIs(n, s0, s1, s2, s3);
+        if (!born)
+          cells = cells & alive;
+        else if (!survives)
+          cells = cells & ~alive;
+        next = next | cells;
+      }
+      return next;
+    }
+  };
+
+  // Conway keeps its hand-written circuit: alive with 2 or 3 neighbours, or dead with exactly 3.
+  // A count of 8 is the only one with s3 set and it has s1 clear, so s3 is never needed.
+  template <> struct FixedRule<conwayRule.birth, conwayRule.survival> {
+    template <class T> LIFE_ALWAYS_INLINE T apply(T s0, T s1, T s2, T, T alive) const {
+      return ~s2 & s1 & (s0 | alive);
+    }
+  };
+
+  using ConwayRule = FixedRule<conwayRule.birth, conwayRule.survival>;
+  using HighLifeRule = FixedRule<highLifeRule.birth, highLifeRule.survival>;
+  using SeedsRule = FixedRule<seedsRule.birth, seedsRule.survival>;
+  using DayAndNightRule = FixedRule<dayAndNightRule.birth, dayAndNightRule.survival>;
+
+  // Rule only known at run time, compiled once into the list of counts it reacts to.
+  class CompiledRule {
+  public:
+    explicit CompiledRule(const LifeRule& rule) {
+      for (int n = 0; n <= 8; n++) {
+        uint8_t kind = uint8_t(((rule.birth >> n) & 1) | ((rule.survival >> n) & 1) << 1);
+        if (kind != 0) terms[termCount++] = {uint8_t(n), kind};
+      }
+    }
+
+    template <class T> LIFE_ALWAYS_INLINE T apply(T s0, T s1, T s2, T s3, T alive) const {
+      T next = alive & ~alive;
+      for (int i = 0; i < termCount; i++) {
+        T cells = countIs(terms[i].count, s0, s1, s2, s3);
+        if (terms[i].kind == bornOnly)
+          cells = cells & ~alive;
+        else if (terms[i].kind == survivesOnly)
+          cells = cells & alive;
+        next = next | cells;
+      }
+      return next;
+    }
+
+  private:
+    static constexpr uint8_t bornOnly = 1, survivesOnly = 2;
+    struct Term {
+      uint8_t count, kind;
+    };
+    Term terms[9] = {};
+    int termCount = 0;
+  };
+
+  // Calls f with the fastest implementation of the rule: a compile-time specialization for the
+  // common rules, the compiled rule for any other.
+  template <class F> decltype(auto) withRule(const LifeRule& rule, F&& f) {
+    if (rule == conwayRule) return f(ConwayRule{});
+    if (rule == highLifeRule) return f(HighLifeRule{});
+    if (rule == seedsRule) return f(SeedsRule{});
+    if (rule == dayAndNightRule) return f(DayAndNightRule{});
+    return f(CompiledRule(rule));
+  }
+}  // namespace life
+
+#endif
@@ -0,0 +1,240 @@
+#ifndef LIFE_SIMD_H
+#define LIFE_SIMD_H
+
+#include <string>
+#include <utility>
+
+#include "life_packed.h"
+
+// The vector kernels need per-function target attributes and the CPUID builtins, so they are only
+// compiled on x86 with GCC or Clang. Every other toolchain gets the scalar packed kernel.
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#  define LIFE_X86_SIMD 1
+#  include <immintrin.h>
+#  define LIFE_TARGET(isa) __attribute__((target(isa)))
+#else
+#  define LIFE_X86_SIMD 0
+#endif
+
+namespace life {
+  // Instruction sets the vectorized stepper can run on, from narrowest to widest.
+  enum class Isa { Scalar, Sse2, Avx2, Avx512 };
+
+  inline const char* isaName(Isa isa) {
+    switch (isa) {
+      case Isa::Sse2:
+        return "sse2";
+      case Isa::Avx2:
+        return "avx2";
+      case Isa::Avx512:
+        return "avx512";
+      default:
+        return "scalar";
+    }
+  }
+
+  inline bool parseIsa(const std::string& name, Isa& isa) {
+    for (Isa candidate : {Isa::Scalar, Isa::Sse2, Isa::Avx2, Isa::Avx512}) {
+      if (name == isaName(candidate)) {
+        isa = candidate;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Widest instruction set this CPU supports.
+  inline Isa detectIsa() {
+#if LIFE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return Isa::Avx512;
+    if (__builtin_cpu_supports("avx2")) return Isa::Avx2;
+    if (__builtin_cpu_supports("sse2")) return Isa::Sse2;
+#endif
+    return Isa::Scalar;
+  }
+
+#if LIFE_X86_SIMD
+  // Each kernel computes the words [1, end) of a line, `lanes` words at a time, and returns the
+  // first word it did not compute. Word 0 and the last word need the toroidal wrap and are left
+  // to the scalar kernel, which is why a vector only runs while its eastern word is not the last.
+
+  // Loads the words at p, and the same words shifted by one column west or east.
+  LIFE_TARGET("sse2") inline __m128i loadSse2(const uint64_t* p) {
+    return _mm_loadu_si128((const __m128i*)p);
+  }
+  LIFE_TARGET("sse2") inline __m128i westSse2(const uint64_t* p) {
+    return _mm_or_si128(_mm_slli_epi64(loadSse2(p), 1), _mm_srli_epi64(loadSse2(p - 1), 63));
+  }
+  LIFE_TARGET("sse2") inline __m128i eastSse2(const uint64_t* p) {
+    return _mm_or_si128(_mm_srli_epi64(loadSse2(p), 1), _mm_slli_epi64(loadSse2(p + 1), 63));
+  }
+
+  template <class Rule>
+  LIFE_TARGET("sse2")
+  inline int stepLineSse2(const uint64_t* up, const uint64_t* mid, const uint64_t* down,
+                          uint64_t* out, int wordsPerRow, const Rule& rule) {
+    int w = 1;
+    for (; w + 2 < wordsPerRow; w += 2) {
+      __m128i nw = westSse2(up + w), n = loadSse2(up + w), ne = eastSse2(up + w);
+      __m128i wv = westSse2(mid + w), alive = loadSse2(mid + w), ev = eastSse2(mid + w);
+      __m128i sw = westSse2(down + w), s = loadSse2(down + w), se = eastSse2(down + w);
+
+      __m128i upXor = _mm_xor_si128(nw, n);
+      __m128i up0 = _mm_xor_si128(upXor, ne);
+      __m128i up1 = _mm_or_si128(_mm_and_si128(nw, n), _mm_and_si128(ne, upXor));
+      __m128i mid0 = _mm_xor_si128(wv, ev), mid1 = _mm_and_si128(wv, ev);
+      __m128i downXor = _mm_xor_si128(sw, s);
+      __m128i down0 = _mm_xor_si128(downXor, se);
+      __m128i down1 = _mm_or_si128(_mm_and_si128(sw, s), _mm_and_si128(se, downXor));
+
+      __m128i onesXor = _mm_xor_si128(up0, mid0);
+      __m128i s0 = _mm_xor_si128(onesXor, down0);
+      __m128i carry = _mm_or_si128(_mm_and_si128(up0, mid0), _mm_and_si128(down0, onesXor));
+      __m128i twosXor = _mm_xor_si128(up1, mid1);
+      __m128i twos = _mm_xor_si128(twosXor, down1);
+      __m128i fours = _mm_or_si128(_mm_and_si128(up1, mid1), _mm_and_si128(down1, twosXor));
+      __m128i s1 = _mm_xor_si128(twos, carry);
+      __m128i foursFromCarry = _mm_and_si128(twos, carry);
+      __m128i s2 = _mm_xor_si128(fours, foursFromCarry);
+      __m128i s3 = _mm_and_si128(fours, foursFromCarry);
+
+      _mm_storeu_si128((__m128i*)(out + w), rule.apply(s0, s1, s2, s3, alive));
+    }
+    return w;
+  }
+
+  LIFE_TARGET("avx2") inline __m256i loadAvx2(const uint64_t* p) {
+    return _mm256_loadu_si256((const __m256i*)p);
+  }
+  LIFE_TARGET("avx2") inline __m256i westAvx2(const uint64_t* p) {
+    return _mm256_or_si256(_mm256_slli_epi64(loadAvx2(p), 1),
+                           _mm256_srli_epi64(loadAvx2(p - 1), 63));
+  }
+  LIFE_TARGET("avx2") inline __m256i eastAvx2(const uint64_t* p) {
+    return _mm256_or_si256(_mm256_srli_epi64(loadAvx2(p), 1),
+                           _mm256_slli_epi64(loadAvx2(p + 1), 63));
+  }
+
+  template <class Rule>
+  LIFE_TARGET("avx2")
+  inline int stepLineAvx2(const uint64_t* up, const uint64_t* mid, const uint64_t* down,
+                          uint64_t* out, int wordsPerRow, const Rule& rule) {
+    int w = 1;
+    for (; w + 4 < wordsPerRow; w += 4) {
+      __m256i nw = westAvx2(up + w), n = loadAvx2(up + w), ne = eastAvx2(up + w);
+      __m256i wv = westAvx2(mid + w), alive = loadAvx2(mid + w), ev = eastAvx2(mid + w);
+      __m256i sw = westAvx2(down + w), s = loadAvx2(down + w), se = eastAvx2(down + w);
+
+      __m256i upXor = _mm256_xor_si256(nw, n);
+      __m256i up0 = _mm256_xor_si256(upXor, ne);
+      __m256i up1 = _mm256_or_si256(_mm256_and_si256(nw, n), _mm256_and_si256(ne, upXor));
+      __m256i mid0 = _mm256_xor_si256(wv, ev), mid1 = _mm256_and_si256(wv, ev);
+      __m256i downXor = _mm256_xor_si256(sw, s);
+      __m256i down0 = _mm256_xor_si256(downXor, se);
+      __m256i down1 = _mm256_or_si256(_mm256_and_si256(sw, s), _mm256_and_si256(se, downXor));
+
+      __m256i onesXor = _mm256_xor_si256(up0, mid0);
+      __m256i s0 = _mm256_xor_si256(onesXor, down0);
+      __m256i carry
+          = _mm256_or_si256(_mm256_and_si256(up0, mid0), _mm256_and_si256(down0, onesXor));
+      __m256i twosXor = _mm256_xor_si256(up1, mid1);
+      __m256i twos = _mm256_xor_si256(twosXor, down1);
+      __m256i fours
+          = _mm256_or_si256(_mm256_and_si256(up1, mid1), _mm256_and_si256(down1, twosXor));
+      __m256i s1 = _mm256_xor_si256(twos, carry);
+      __m256i foursFromCarry = _mm256_and_si256(twos, carry);
+      __m256i s2 = _mm256_xor_si256(fours, foursFromCarry);
+      __m256i s3 = _mm256_and_si256(fours, foursFromCarry);
+
+      _mm256_storeu_si256((__m256i*)(out + w), rule.apply(s0, s1, s2, s3, alive));
+    }
+    return w;
+  }
+
+  // AVX-512 folds every full adder into two ternary-logic instructions:
+  // 0x96 is a ^ b ^ c and 0xE8 is the majority of a, b and c.
+  LIFE_TARGET("avx512f") inline __m512i loadAvx512(const uint64_t* p) {
+    return _mm512_loadu_si512((const void*)p);
+  }
+  LIFE_TARGET("avx512f") inline __m512i westAvx512(const uint64_t* p) {
+    return _mm512_or_si512(_mm512_slli_epi64(loadAvx512(p), 1),
+                           _mm512_srli_epi64(loadAvx512(p - 1), 63));
+  }
+  LIFE_TARGET("avx512f") inline __m512i eastAvx512(const uint64_t* p) {
+    return _mm512_or_si512(_mm512_srli_epi64(loadAvx512(p), 1),
+                           _mm512_slli_epi64(loadAvx512(p + 1), 63));
+  }
+  LIFE_TARGET("avx512f") inline __m512i xor3Avx512(__m512i a, __m512i b, __m512i c) {
+    return _mm512_ternarylogic_epi64(a, b, c, 0x96);
+  }
+  LIFE_TARGET("avx512f") inline __m512i majorityAvx512(__m512i a, __m512i b, __m512i c) {
+    return _mm512_ternarylogic_epi64(a, b, c, 0xE8);
+  }
+
+  template <class Rule>
+  LIFE_TARGET("avx512f")
+  inline int stepLineAvx512(const uint64_t* up, const uint64_t* mid, const uint64_t* down,
+                            uint64_t* out, int wordsPerRow, const Rule& rule) {
+    int w = 1;
+    for (; w + 8 < wordsPerRow; w += 8) {
+      __m512i nw = westAvx512(up + w), n = loadAvx512(up + w), ne = eastAvx512(up + w);
+      __m512i wv = westAvx512(mid + w), alive = loadAvx512(mid + w), ev = eastAvx512(mid + w);
+      __m512i sw = westAvx512(down + w), s = loadAvx512(down + w), se = eastAvx512(down + w);
+
+      __m512i up0 = xor3Avx512(nw, n, ne), up1 = majorityAvx512(nw, n, ne);
+      __m512i mid0 = _mm512_xor_si512(wv, ev), mid1 = _mm512_and_si512(wv, ev);
+      __m512i down0 = xor3Avx512(sw, s, se), down1 = majorityAvx512(sw, s, se);
+
+      __m512i s0 = xor3Avx512(up0, mid0, down0);
+      __m512i carry = majorityAvx512(up0, mid0, down0);
+      __m512i twos = xor3Avx512(up1, mid1, down1);
+      __m512i fours = majorityAvx512(up1, mid1, down1);
+      __m512i s1 = _mm512_xor_si512(twos, carry);
+      __m512i foursFromCarry = _mm512_and_si512(twos, carry);
+      __m512i s2 = _mm512_xor_si512(fours, foursFromCarry);
+      __m512i s3 = _mm512_and_si512(fours, foursFromCarry);
+
+      _mm512_storeu_si512((void*)(out + w), rule.apply(s0, s1, s2, s3, alive));
+    }
+    return w;
+  }
+#endif
+
+  // Computes the lines [firstLine, lastLine) of the next generation with the given instruction
+  // set. Words the vector kernel cannot cover go through the scalar packed kernel, so all paths
+  // produce the same bits.
+  template <class Rule = ConwayRule>
+  inline void stepLinesSimd(Isa isa, const PackedBoard& current, PackedBoard& next, int firstLine,
+                            int lastLine, const Rule& rule = Rule()) {
+    if (current.wordsPerRow == 0) return;
+    for (int y = firstLine; y < lastLine; y++) {
+      int w = 1;
+#if LIFE_X86_SIMD
+      const uint64_t* up = current.row(lineAbove(y, current.lines));
+      const uint64_t* mid = current.row(y);
+      const uint64_t* down = current.row(lineBelow(y, current.lines));
+      uint64_t* out = next.row(y);
+      if (isa == Isa::Avx512)
+        w = stepLineAvx512(up, mid, down, out, current.wordsPerRow, rule);
+      else if (isa == Isa::Avx2)
+        w = stepLineAvx2(up, mid, down, out, current.wordsPerRow, rule);
+      else if (isa == Isa::Sse2)
+        w = stepLineSse2(up, mid, down, out, current.wordsPerRow, rule);
+#endif
+      stepWords(current, next, y, 0, 1, rule);
+      stepWords(current, next, y, std::max(w, 1), current.wordsPerRow, rule);
+    }
+  }
+
+  template <class Rule = ConwayRule>
+  inline void stepSimd(Isa isa, PackedBoard& board, PackedBoard& scratch,
+                       const Rule& rule = Rule()) {
+    if (scratch.columns != board.columns || scratch.lines != board.lines)
+      scratch.resize(board.columns, board.lines);
+    stepLinesSimd(isa, board, scratch, 0, board.lines, rule);
+    std::swap(board.words, scratch.words);
+  }
+}  // namespace life
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef LIFE_SPARSE_H
+#define LIFE_SPARSE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "life_packed.h"
+
+namespace life {
+  // Steps only the parts of the board that can change. The board is cut in tiles of one word by
+  // `tileLines` lines (64x64 cells), and a tile is recomputed only if it or one of its 8
+  // neighbours changed in the previous generation. Any other tile is dead or still and keeps its
+  // cells: the back buffer already holds them, since the tile did not change between the
+  // generation it holds and the current one.
+  class SparseStepper {
+  public:
+    static constexpr int tileLines = 64;
+
+    // Word changes nobody follows.
+    struct IgnoreWords {
+      void operator()(size_t, uint64_t, uint64_t) const {}
+    };
+
+    // Advances the board one generation, `scratch` being the back buffer of the previous call.
+    template <class Rule = ConwayRule>
+    void step(PackedBoard& board, PackedBoard& scratch, const Rule& rule = Rule()) {
+      step(board, scratch, rule, IgnoreWords());
+    }
+
+    // Also calls wordChanged(index, before, after) for every word of the board that changed.
+    // Only the recomputed tiles can change, so this costs nothing on the others.
+    template <class Rule, class WordChanged>
+    void step(PackedBoard& board, PackedBoard& scratch, const Rule& rule, WordChanged&& wordChanged) {
+      constexpr bool reportWords = !std::is_same_v<std::decay_t<WordChanged>, IgnoreWords>;
+      if (scratch.columns != board.columns || scratch.lines != board.lines || changed.empty())
+        reset(board, scratch);
+
+      markActive();
+      int active = 0;
+      for (int ty = 0; ty < tilesY; ty++) {
+        int firstLine = ty * tileLines;
+        int lastLine = std::min(firstLine + tileLines, board.lines);
+        for (int tx = 0; tx < tilesX; tx++) {
+          size_t tile = size_t(ty) * tilesX + tx;
+          nextChanged[tile] = 0;
+          if (!activeTiles[tile]) continue;
+          active++;
+          uint64_t difference = 0;
+          for (int y = firstLine; y < lastLine; y++) {
+            stepWords(board, scratch, y, tx, tx + 1, rule);
+            uint64_t before = board.row(y)[tx], after = scratch.row(y)[tx];
+            difference |= before ^ after;
+            if constexpr (reportWords)
+              if (before != after) wordChanged(size_t(y) * tilesX + tx, before, after);
+          }
+          nextChanged[tile] = difference != 0;
+        }
+      }
+
+      std::swap(board.words, scratch.words);
+      std::swap(changed, nextChanged);
+      activeTotal += uint64_t(active);
+      activePeak = std::max(activePeak, active);
+      generations++;
+    }
+
+    int tileCount() const { return tilesX * tilesY; }
+
+    // Tiles recomputed by all the calls to step so far, and by the busiest one; kept as running
+    // totals so a long run takes no more memory than a short one.
+    uint64_t activeTilesStepped() const { return activeTotal; }
+    int peakActiveTiles() const { return activePeak; }
+    uint64_t generationsStepped() const { return generations; }
+
+  private:
+    int tilesX = 0, tilesY = 0;
+    std::vector<uint8_t> changed, nextChanged, activeTiles;
+    uint64_t activeTotal = 0, generations = 0;
+    int activePeak = 0;
+
+    // A new board has no history, so every tile is treated as changed once.
+    void reset(const PackedBoard& board, PackedBoard& scratch) {
+      scratch.resize(board.columns, board.lines);
+      tilesX = board.wordsPerRow;
+      tilesY = (board.lines + tileLines - 1) / tileLines;
+      changed.assign(size_t(tilesX) * tilesY, 1);
+      nextChanged.assign(changed.size(), 0);
+      activeTiles.assign(changed.size(), 0);
+    }
+
+    // A tile is active when it or a neighbour changed; the tile grid wraps like the board.
+    void markActive() {
+      for (int ty = 0; ty < tilesY; ty++) {
+        for (int tx = 0; tx < tilesX; tx++) {
+          uint8_t any = 0;
+          for (int dy = -1; dy <= 1 && !any; dy++) {
+            int ny = (ty + dy + tilesY) % tilesY;
+            for (int dx = -1; dx <= 1; dx++)
+              any |= changed[size_t(ny) * tilesX + (tx + dx + tilesX) % tilesX];
+          }
+          activeTiles[size_t(ty) * tilesX + tx] = any;
+        }
+      }
+    }
+  };
+}  // namespace life
+
+#endif
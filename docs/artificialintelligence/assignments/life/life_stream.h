@@ -0,0 +1,258 @@
+#ifndef LIFE_STREAM_H
+#define LIFE_STREAM_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "life_packed.h"
+#include "life_simd.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#  define LIFE_HAS_MMAP 1
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#else
+#  define LIFE_HAS_MMAP 0
+#endif
+
+namespace life {
+  // Header of a packed board file. It carries the same three numbers as the text format and is
+  // followed by `lines` rows of `wordsPerRow` 64-bit words in the host byte order, laid out like
+  // the rows of a PackedBoard.
+  struct PackedFileHeader {
+    char magic[4] = {'L', 'I', 'F', 'E'};
+    uint32_t version = 1;
+    uint32_t columns = 0;
+    uint32_t lines = 0;
+    uint64_t steps = 0;
+    uint32_t wordsPerRow = 0;
+    uint32_t reserved = 0;
+
+    bool valid() const {
+      return std::memcmp(magic, "LIFE", 4) == 0 && version == 1
+             && wordsPerRow == (uint64_t(columns) + 63) / 64;
+    }
+    size_t fileSize() const {
+      return sizeof(PackedFileHeader) + size_t(lines) * wordsPerRow * sizeof(uint64_t);
+    }
+  };
+  static_assert(sizeof(PackedFileHeader) == 32, "the header keeps the rows 8-byte aligned");
+
+  // A whole file mapped in memory, either read-only or created with a given size.
+  class MappedFile {
+  public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    bool openRead(const std::string& path) { return map(path, false, 0); }
+    bool create(const std::string& path, size_t size) { return map(path, true, size); }
+
+    uint8_t* data() { return address; }
+    size_t size() const { return length; }
+
+    void close() {
+#if LIFE_HAS_MMAP
+      if (address != nullptr) munmap(address, length);
+      if (descriptor >= 0) ::close(descriptor);
+#endif
+      address = nullptr;
+      descriptor = -1;
+      length = 0;
+    }
+
+  private:
+    uint8_t* address = nullptr;
+    size_t length = 0;
+    int descriptor = -1;
+
+    bool map(const std::string& path, bool writable, size_t size) {
+      close();
+#if LIFE_HAS_MMAP
+      descriptor = writable ? ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644)
+                            : ::open(path.c_str(), O_RDONLY);
+      if (descriptor < 0) {
+        std::cerr << "cannot open " << path << std::endl;
+        return false;
+      }
+      if (writable) {
+        if (ftruncate(descriptor, off_t(size)) != 0) {
+          std::cerr << "cannot resize " << path << std::endl;
+          close();
+          return false;
+        }
+      } else {
+        struct stat status {};
+        fstat(descriptor, &status);
+        size = size_t(status.st_size);
+      }
+      if (size == 0) return true;
+      void* mapped = mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED,
+                          descriptor, 0);
+      if (mapped == MAP_FAILED) {
+        std::cerr << "cannot map " << path << std::endl;
+        close();
+        return false;
+      }
+      address = static_cast<uint8_t*>(mapped);
+      length = size;
+      return true;
+#else
+      (void)writable;
+      (void)size;
+      std::cerr << "memory mapped boards are not supported on this platform: " << path
+                << std::endl;
+      return false;
+#endif
+    }
+  };
+
+  // Creates an empty file in the temporary directory and returns its path, or "" on failure.
+  inline std::string makeTemporaryFile() {
+#if LIFE_HAS_MMAP
+    const char* directory = std::getenv("TMPDIR");
+    std::string path = std::string(directory != nullptr ? directory : "/tmp") + "/ai-life-XXXXXX";
+    int descriptor = mkstemp(path.data());
+    if (descriptor < 0) return "";
+    ::close(descriptor);
+    return path;
+#else
+    return "";
+#endif
+  }
+
+  // Converts the text format read from `in` into a packed board file written to `out`, one row
+  // at a time so the board never has to fit in memory.
+  inline bool textToPacked(std::FILE* in, std::FILE* out) {
+    int columns, lines;
+    long long steps;
+    if (std::fscanf(in, "%d %d %lld", &columns, &lines, &steps) != 3 || columns < 0 || lines < 0) {
+      std::cerr << "invalid text board header" << std::endl;
+      return false;
+    }
+    PackedFileHeader header;
+    header.columns = uint32_t(columns);
+    header.lines = uint32_t(lines);
+    header.steps = uint64_t(steps);
+    header.wordsPerRow = (header.columns + 63) / 64;
+    std::fwrite(&header, sizeof(header), 1, out);
+
+    std::vector<uint64_t> row(header.wordsPerRow);
+    for (int y = 0; y < lines; y++) {
+      std::fill(row.begin(), row.end(), 0);
+      int c = std::getc(in);
+      while (c == '\n' || c == '\r' || c == ' ') c = std::getc(in);
+      for (int x = 0; x < columns && c != EOF && c != '\n'; x++, c = std::getc(in))
+        if (c == '#') row[x >> 6] |= uint64_t{1} << (x & 63);
+      while (c != '\n' && c != EOF) c = std::getc(in);
+      std::fwrite(row.data(), sizeof(uint64_t), row.size(), out);
+    }
+    return std::ferror(out) == 0;
+  }
+
+  // Converts a packed board file read from `in` back into the text format. Without the header
+  // line this is exactly what the simulator prints.
+  inline bool packedToText(std::FILE* in, std::FILE* out, bool withHeader) {
+    PackedFileHeader header;
+    if (std::fread(&header, sizeof(header), 1, in) != 1 || !header.valid()) {
+      std::cerr << "invalid packed board header" << std::endl;
+      return false;
+    }
+    if (withHeader)
+      std::fprintf(out, "%u %u %llu\n", header.columns, header.lines,
+                   (unsigned long long)header.steps);
+    std::vector<uint64_t> row(header.wordsPerRow);
+    std::string text(size_t(header.columns) + 1, '\n');
+    for (uint32_t y = 0; y < header.lines; y++) {
+      if (std::fread(row.data(), sizeof(uint64_t), row.size(), in) != row.size()) {
+        std::cerr << "packed board ends after " << y << " lines" << std::endl;
+        return false;
+      }
+      for (uint32_t x = 0; x < header.columns; x++)
+        text[x] = (row[x >> 6] >> (x & 63)) & 1 ? '#' : '.';
+      std::fwrite(text.data(), 1, text.size(), out);
+    }
+    return std::ferror(out) == 0;
+  }
+
+  // Steps a packed board file out of core and writes the result to another one, with the steps
+  // left in the header set to zero. The board is processed in bands of `bandLines` lines; each
+  // band is loaded with `generations` extra lines on both sides, which lets it advance that many
+  // generations in memory before its centre is written back, so the files are only read and
+  // written once every `generations` generations. The input file is never modified.
+  template <class Rule = ConwayRule>
+  inline bool stepPackedFile(const std::string& inputPath, const std::string& outputPath,
+                             int bandLines, int generations, Isa isa,
+                             const Rule& rule = Rule()) {
+    MappedFile input;
+    if (!input.openRead(inputPath)) return false;
+    PackedFileHeader header;
+    if (input.size() < sizeof(header)) {
+      std::cerr << "invalid packed board file: " << inputPath << std::endl;
+      return false;
+    }
+    std::memcpy(&header, input.data(), sizeof(header));
+    if (!header.valid() || input.size() < header.fileSize()) {
+      std::cerr << "invalid packed board file: " << inputPath << std::endl;
+      return false;
+    }
+
+    int columns = int(header.columns), lines = int(header.lines);
+    size_t rowBytes = size_t(header.wordsPerRow) * sizeof(uint64_t);
+    uint64_t remaining = header.steps;
+    header.steps = 0;
+    std::string temporaryPath = outputPath + ".tmp";
+    PackedBoard band, scratch;
+
+    // every pass reads the previous result and writes the next one, the first one reads the input
+    bool firstPass = true;
+    do {
+      int passGenerations = int(std::min<uint64_t>(remaining, uint64_t(generations)));
+      remaining -= passGenerations;
+
+      MappedFile previous;
+      if (!firstPass && !previous.openRead(outputPath)) return false;
+      MappedFile& source = firstPass ? input : previous;
+      MappedFile destination;
+      if (!destination.create(temporaryPath, header.fileSize())) return false;
+      std::memcpy(destination.data(), &header, sizeof(header));
+      const uint8_t* sourceRows = source.data() + sizeof(header);
+      uint8_t* destinationRows = destination.data() + sizeof(header);
+
+      for (int firstLine = 0; firstLine < lines; firstLine += bandLines) {
+        int count = std::min(bandLines, lines - firstLine);
+        band.resize(columns, count + 2 * passGenerations);
+        for (int i = 0; i < band.lines; i++) {
+          int64_t line = (int64_t(firstLine) - passGenerations + i) % lines;
+          if (line < 0) line += lines;
+          std::memcpy(band.row(i), sourceRows + size_t(line) * rowBytes, rowBytes);
+        }
+        // the lines closest to the band edges get wrong neighbours, one more line per
+        // generation, which never reaches the centre that is written back
+        for (int i = 0; i < passGenerations; i++) stepSimd(isa, band, scratch, rule);
+        std::memcpy(destinationRows + size_t(firstLine) * rowBytes, band.row(passGenerations),
+                    size_t(count) * rowBytes);
+      }
+
+      destination.close();
+      previous.close();
+      if (std::rename(temporaryPath.c_str(), outputPath.c_str()) != 0) {
+        std::cerr << "cannot write " << outputPath << std::endl;
+        return false;
+      }
+      firstPass = false;
+    } while (remaining > 0);
+    return true;
+  }
+}  // namespace life
+
+#endif
@@ -1,6 +1,20 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <string>
+#include <thread>
 #include <vector>
 #include <stack>
+
+#include "maze_batch.h"
+#include "maze_generators.h"
+#include "maze_grid.h"
+#include "maze_render.h"
+#include "maze_solver.h"
 using namespace std;
 
 struct Node
@@ -21,14 +35,420 @@ struct Node
 
 bool CheckForNeighbors(Node* CurrentNode, vector<Node*>& NeighborList, const vector<vector<Node*>>& NodeList, int Rows, int Columns);
 
-int main()
+//command line options, the defaults keep the original node by node generator
+struct MazeOptions
+{
+  string engine = "nodes";
+  //flat engine: how the maze is carved, see maze_generators.h
+  string generator = "backtracker";
+  //print how long generating the maze took on stderr
+  bool stats = false;
+  //flat engine: solve the maze and draw the path over it, see maze_solver.h
+  bool solve = false;
+  maze::Search search = maze::Search::Bfs;
+  //the cells the path goes between, -1 for the top left and the bottom right corners
+  int FromX = -1, FromY = -1, ToX = -1, ToY = -1;
+  //print the moves from the start to every cell instead of the maze
+  bool distances = false;
+  //read "x1 y1 x2 y2" queries after the maze size and answer every one instead of printing the maze
+  bool queries = false;
+  //read mazes until the end of the input and generate them on several threads
+  bool batch = false;
+  int threads = max(1u, thread::hardware_concurrency());
+};
+
+//reads "X,Y" into two ints
+bool ParseCell(const string& Text, int& X, int& Y)
+{
+  return sscanf(Text.c_str(), "%d,%d", &X, &Y) == 2;
+}
+
+//nodes: one heap allocated Node per cell, the original generator
+//flat: one byte per cell in a single array and an explicit stack, see maze_grid.h
+const vector<string> mazeEngines = {"nodes", "flat"};
+
+bool parseOptions(int argc, char* argv[], MazeOptions& options)
+{
+  bool engineGiven = false;
+  for(int i = 1; i < argc; i++)
+  {
+    string arg = argv[i];
+    if(arg.rfind("--engine=", 0) == 0)
+    {
+      options.engine = arg.substr(9);
+      engineGiven = true;
+    }
+    else if(arg.rfind("--generator=", 0) == 0)
+    {
+      options.generator = arg.substr(12);
+    }
+    else if(arg == "--stats")
+    {
+      options.stats = true;
+    }
+    else if(arg.rfind("--solve=", 0) == 0)
+    {
+      options.solve = true;
+      if(!maze::parseSearch(arg.substr(8), options.search))
+      {
+        cerr << "unknown search: " << arg.substr(8) << endl;
+        return false;
+      }
+    }
+    else if(arg.rfind("--from=", 0) == 0 || arg.rfind("--to=", 0) == 0)
+    {
+      bool From = arg[2] == 'f';
+      if(!ParseCell(arg.substr(From ? 7 : 5), From ? options.FromX : options.ToX, From ? options.FromY : options.ToY))
+      {
+        cerr << "expected a cell as X,Y: " << arg << endl;
+        return false;
+      }
+    }
+    else if(arg == "--distances")
+    {
+      options.distances = true;
+    }
+    else if(arg == "--queries")
+    {
+      options.queries = true;
+    }
+    else if(arg == "--batch")
+    {
+      options.batch = true;
+    }
+    else if(arg.rfind("--threads=", 0) == 0)
+    {
+      options.threads = atoi(arg.c_str() + 10);
+      if(options.threads < 1)
+      {
+        cerr << "--threads needs at least 1 thread" << endl;
+        return false;
+      }
+    }
+    else
+    {
+      cerr << "unknown option: " << arg << endl;
+      return false;
+    }
+  }
+
+  //the nodes engine prints straight to cout, so batches default to the flat one
+  if(options.batch && !engineGiven)
+  {
+    options.engine = "flat";
+  }
+
+  if(find(mazeEngines.begin(), mazeEngines.end(), options.engine) == mazeEngines.end())
+  {
+    cerr << "unknown engine: " << options.engine << endl;
+    return false;
+  }
+  if(!maze::isGenerator(options.generator))
+  {
+    cerr << "unknown generator: " << options.generator << endl;
+    return false;
+  }
+  if(options.engine == "nodes" && options.generator != "backtracker")
+  {
+    cerr << "the nodes engine only runs the backtracker, pick the flat engine for " << options.generator << endl;
+    return false;
+  }
+  if(options.solve || options.distances || options.queries)
+  {
+    if(options.engine != "flat" || options.generator == "eller")
+    {
+      cerr << "solving needs the whole maze in memory: the flat engine and a generator other than eller" << endl;
+      return false;
+    }
+    if(options.distances + options.queries > 1 || (options.solve && options.distances))
+    {
+      cerr << "pick one of --solve, --distances and --queries, --queries takes its search from --solve" << endl;
+      return false;
+    }
+  }
+  if(options.batch && (options.engine != "flat" || options.solve || options.distances || options.queries))
+  {
+    cerr << "--batch only generates and prints mazes with the flat engine" << endl;
+    return false;
+  }
+  return true;
+}
+
+//the cell at X,Y, or false when it is outside the maze
+bool CellAt(const maze::MazeGrid& Grid, int X, int Y, uint32_t& Cell)
+{
+  if(X < 0 || Y < 0 || X >= Grid.columns || Y >= Grid.rows)
+    return false;
+  Cell = uint32_t(Grid.index(X, Y));
+  return true;
+}
+
+//solves, or answers the queries on, the maze in Grid instead of printing it as is
+int SolveFlatMaze(maze::MazeGrid& Grid, maze::MazeRenderer& Renderer, const MazeOptions& options)
+{
+  maze::MazeSolver Solver;
+  if(options.queries)
+  {
+    //one line per query: the moves on the path or -1 and the cells expanded, with --stats the
+    //time each query took on stderr
+    int X1, Y1, X2, Y2;
+    for(size_t Query = 0; !(cin >> ws).eof(); Query++)
+    {
+      uint32_t From, To;
+      if(!(cin >> X1 >> Y1 >> X2 >> Y2))
+      {
+        cerr << "query " << Query << " is not x1 y1 x2 y2" << endl;
+        return 1;
+      }
+      if(!CellAt(Grid, X1, Y1, From) || !CellAt(Grid, X2, Y2, To))
+      {
+        cerr << "query outside the maze: " << X1 << " " << Y1 << " " << X2 << " " << Y2 << endl;
+        return 1;
+      }
+      auto start = chrono::steady_clock::now();
+      maze::SolveResult Result = Solver.solve(Grid, options.search, From, To);
+      double microseconds = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+      cout << (Result.found ? int64_t(Result.length) : -1) << " " << Result.expanded << "\n";
+      if(options.stats)
+        cerr << "query " << Query << ": " << Result.expanded << " cells expanded in " << microseconds << " us\n";
+    }
+    cout.flush();
+    return cout ? 0 : 1;
+  }
+
+  uint32_t From, To;
+  int FromX = options.FromX < 0 ? 0 : options.FromX, FromY = options.FromY < 0 ? 0 : options.FromY;
+  int ToX = options.ToX < 0 ? Grid.columns - 1 : options.ToX, ToY = options.ToY < 0 ? Grid.rows - 1 : options.ToY;
+  if(!CellAt(Grid, FromX, FromY, From) || !CellAt(Grid, ToX, ToY, To))
+  {
+    cerr << "--from and --to need cells inside the maze" << endl;
+    return 1;
+  }
+
+  auto start = chrono::steady_clock::now();
+  if(options.distances)
+  {
+    vector<uint32_t> Field;
+    size_t Expanded = Solver.distances(Grid, From, Field);
+    double milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    for(int y = 0; y < Grid.rows; y++)
+    {
+      for(int x = 0; x < Grid.columns; x++)
+      {
+        uint32_t Moves = Field[Grid.index(x, y)];
+        cout << (x ? " " : "") << (Moves == maze::MazeSolver::unreachable ? int64_t(-1) : int64_t(Moves));
+      }
+      cout << "\n";
+    }
+    cout.flush();
+    if(options.stats)
+      cerr << "distances: " << Expanded << " cells expanded in " << milliseconds << " ms" << endl;
+    return cout ? 0 : 1;
+  }
+
+  maze::SolveResult Result = Solver.solve(Grid, options.search, From, To);
+  double milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+  Solver.overlay(Grid);
+  Renderer.render(Grid);
+  if(options.stats)
+  {
+    cerr << maze::searchName(options.search) << ": ";
+    if(Result.found)
+      cerr << "path of " << Result.length << " moves";
+    else
+      cerr << "no path";
+    cerr << ", " << Result.expanded << " cells expanded in " << milliseconds << " ms, " << Solver.memoryBytes() << " bytes" << endl;
+  }
+  return 0;
+}
+
+//what generating a maze keeps from one maze to the next: the cells and the generator buffers
+struct MazeWorker
+{
+  maze::MazeGrid Grid;
+  maze::DepthFirstGenerator Backtracker;
+  maze::EllerGenerator Eller;
+  maze::KruskalGenerator Kruskal;
+  maze::WilsonGenerator Wilson;
+
+  size_t MemoryBytes() const
+  {
+    return Grid.cells.capacity() + Backtracker.memoryBytes() + Eller.memoryBytes() + Kruskal.memoryBytes() + Wilson.memoryBytes();
+  }
+};
+
+//whether the generator can hold a maze this size, says why not on stderr
+bool CheckMazeSize(int Columns, int Rows, const string& generator)
 {
+  //eller only ever holds a row, the other generators hold the whole grid
+  uint64_t maxCells = generator == "eller" ? UINT64_MAX : generator == "kruskal" ? maze::KruskalGenerator::maxCells : UINT32_MAX;
+  if(Columns < 1 || Rows < 1 || uint64_t(Columns) * uint64_t(Rows) > maxCells)
+  {
+    cerr << "the " << generator << " generator needs between 1 and " << maxCells << " cells" << endl;
+    return false;
+  }
+  return true;
+}
+
+//carves a maze into Worker.Grid, except eller, which renders its rows as it goes
+void GenerateFlatMaze(MazeWorker& Worker, maze::MazeRenderer& Renderer, int Columns, int Rows, int Seed, const string& generator)
+{
+  maze::SeededRandom Seeded(Seed);
+  if(generator == "eller")
+  {
+    Worker.Eller.generate(Columns, Rows, Seeded, Renderer);
+    return;
+  }
+
+  Worker.Grid.reset(Columns, Rows);
+  if(generator == "kruskal")
+  {
+    Worker.Kruskal.generate(Worker.Grid, Seeded);
+  }
+  else if(generator == "wilson")
+  {
+    Worker.Wilson.generate(Worker.Grid, Seeded);
+  }
+  else
+  {
+    maze::RandomTable Random(Seed);
+    Worker.Backtracker.generate(Worker.Grid, Random);
+  }
+}
+
+//generates and prints the maze with the flat engine
+int RunFlatMaze(int Columns, int Rows, int Seed, const MazeOptions& options)
+{
+  if(!CheckMazeSize(Columns, Rows, options.generator))
+    return 1;
+
+  auto start = chrono::steady_clock::now();
+  MazeWorker Worker;
+  maze::MazeRenderer Renderer(stdout);
+  //eller prints its rows while it generates the maze, so its time includes the printing
+  GenerateFlatMaze(Worker, Renderer, Columns, Rows, Seed, options.generator);
+  double milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+  if(options.generator != "eller")
+  {
+    if(!options.solve && !options.distances && !options.queries)
+    {
+      Renderer.render(Worker.Grid);
+    }
+    else if(int Failed = SolveFlatMaze(Worker.Grid, Renderer, options))
+    {
+      return Failed;
+    }
+  }
+
+  if(!Renderer.flush())
+  {
+    cerr << "cannot write the maze" << endl;
+    return 1;
+  }
+
+  if(options.stats)
+  {
+    double total = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cerr << options.generator << ": " << Columns << "x" << Rows << " maze generated in " << milliseconds << " ms, "
+         << Worker.MemoryBytes() << " bytes, printed in " << total - milliseconds << " more ms" << endl;
+  }
+  return 0;
+}
+
+//generates every maze of the input, one maze per thread at a time
+//every worker keeps its grid, generator buffers and text buffer from one maze to the next, and
+//the mazes come out in input order on stdout as soon as all the ones before them did
+bool RunBatch(const MazeOptions& options)
+{
+  vector<maze::BatchMaze> Mazes;
+  if(!maze::readBatch(cin, Mazes))
+  {
+    cerr << "maze " << Mazes.size() << " of the batch is not columns rows seed" << endl;
+    return false;
+  }
+  for(size_t i = 0; i < Mazes.size(); i++)
+  {
+    if(!CheckMazeSize(Mazes[i].columns, Mazes[i].rows, options.generator))
+    {
+      cerr << "in maze " << i << " of the batch" << endl;
+      return false;
+    }
+  }
+
+  int Threads = int(min<size_t>(size_t(options.threads), max<size_t>(Mazes.size(), 1)));
+  vector<MazeWorker> Workers(Threads);
+  vector<maze::MazeRenderer> Texts(Threads);
+  //a few mazes per thread may wait for the ones before them
+  maze::OrderedWriter Writer(stdout, Mazes.size(), 4 * size_t(Threads));
+  vector<double> milliseconds(Mazes.size());
+  atomic<size_t> NextMaze{0};
+
+  auto batchStart = chrono::steady_clock::now();
+  auto Work = [&](int worker)
+  {
+    maze::MazeRenderer& Text = Texts[worker];
+    for(size_t index = NextMaze++; index < Mazes.size(); index = NextMaze++)
+    {
+      const maze::BatchMaze& Spec = Mazes[index];
+      Writer.waitForTurn(index);
+      auto start = chrono::steady_clock::now();
+      GenerateFlatMaze(Workers[worker], Text, Spec.columns, Spec.rows, Spec.seed, options.generator);
+      if(options.generator != "eller")
+        Text.render(Workers[worker].Grid);
+      milliseconds[index] = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+      Writer.finished(index, Text.text(), Text.size());
+      Text.clear();
+    }
+  };
+  vector<thread> Pool;
+  for(int w = 1; w < Threads; w++)
+    Pool.emplace_back(Work, w);
+  Work(0);
+  for(auto& Thread : Pool)
+    Thread.join();
+
+  if(!Writer.ok() || fflush(stdout) != 0)
+  {
+    cerr << "cannot write the mazes" << endl;
+    return false;
+  }
+  double wall = chrono::duration<double, milli>(chrono::steady_clock::now() - batchStart).count();
+
+  uint64_t Cells = 0;
+  for(size_t i = 0; i < Mazes.size(); i++)
+  {
+    if(options.stats)
+      cerr << "maze " << i << ": " << Mazes[i].columns << "x" << Mazes[i].rows << " seed " << Mazes[i].seed << " in " << milliseconds[i] << " ms\n";
+    Cells += uint64_t(Mazes[i].columns) * uint64_t(Mazes[i].rows);
+  }
+  size_t Memory = Writer.peakWaitingBytes();
+  for(int w = 0; w < Threads; w++)
+    Memory += Workers[w].MemoryBytes() + Texts[w].memoryBytes();
+  double seconds = max(wall, 1e-6) / 1000;
+  cerr << "batch: " << Mazes.size() << " " << options.generator << " mazes, " << Cells << " cells in " << wall
+       << " ms on " << Threads << " threads, " << Mazes.size() / seconds << " mazes/s, " << Cells / seconds << " cells/s, "
+       << Writer.written() << " bytes of text, " << Memory << " bytes" << endl;
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  MazeOptions options;
+  if(!parseOptions(argc, argv, options))
+    return 1;
+
+  if(options.batch)
+    return RunBatch(options) ? 0 : 1;
+
   int Columns, Rows, Seed;
+  cin >> Columns >> Rows >> Seed;
+  if(options.engine == "flat")
+    return RunFlatMaze(Columns, Rows, Seed, options);
+
   const int RandomLength = 100;
   int Random[RandomLength] = {72, 99, 56, 34, 43, 62, 31, 4, 70, 22, 6, 65, 96, 71, 29, 9, 98, 41, 90, 7, 30, 3, 97, 49, 63, 88, 47, 82, 91, 54, 74, 2, 86, 14, 58, 35, 89, 11, 10, 60, 28, 21, 52, 50, 55, 69, 76, 94, 23, 66, 15, 57, 44, 18, 67, 5, 24, 33, 77, 53, 51, 59, 20, 42, 80, 61, 1, 0, 38, 64, 45, 92, 46, 79, 93, 95, 37, 40, 83, 13, 12, 78, 75, 73, 84, 81, 8, 32, 27, 19, 87, 85, 16, 25, 17, 68, 26, 39, 48, 36};
 
   //Fill Nodes
-  cin >> Columns >> Rows >> Seed;
   vector<vector<Node*>> NodeList( Rows , vector<Node*> (Columns));
   for (int i = 0; i < Rows; ++i)
   {
@@ -0,0 +1,95 @@
+#ifndef MAZE_BATCH_H
+#define MAZE_BATCH_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <istream>
+#include <mutex>
+#include <vector>
+
+namespace maze {
+  // One maze of a batch, as read from the input.
+  struct BatchMaze {
+    int columns = 0, rows = 0, seed = 0;
+  };
+
+  // Reads mazes in the usual `columns rows seed` format one after the other until the end of
+  // the input. Returns false if something else than a maze is found, or a maze cut short.
+  inline bool readBatch(std::istream& in, std::vector<BatchMaze>& mazes) {
+    BatchMaze next;
+    while (!(in >> std::ws).eof()) {
+      if (!(in >> next.columns >> next.rows >> next.seed)) return false;
+      mazes.push_back(next);
+    }
+    return true;
+  }
+
+  // Writes the texts of a batch in input order while the batch is generated. The worker that
+  // finishes the next maze to write writes it straight from its own buffer, then the mazes after
+  // it that were already waiting; a worker that finishes a maze ahead of that leaves a copy of
+  // its text. No maze is started more than `window` places ahead of the next one to write, so
+  // there are never more than `window` texts waiting, whatever the size of the batch.
+  class OrderedWriter {
+  public:
+    OrderedWriter(std::FILE* out, size_t count, size_t window)
+        : out(out), window(std::max<size_t>(window, 1)), waiting(count) {}
+
+    // Blocks until maze `index` is close enough to the next one to write.
+    void waitForTurn(size_t index) {
+      std::unique_lock<std::mutex> lock(mutex);
+      turn.wait(lock, [&] { return index < nextToWrite + window; });
+    }
+
+    // The text of maze `index`, given once for every maze.
+    void finished(size_t index, const char* text, size_t size) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (index != nextToWrite) {
+        waiting[index].text.assign(text, text + size);
+        waiting[index].done = true;
+        waitingBytes += size;
+        peakBytes = std::max(peakBytes, waitingBytes);
+        return;
+      }
+      write(text, size);
+      while (++nextToWrite < waiting.size() && waiting[nextToWrite].done) {
+        std::vector<char>& next = waiting[nextToWrite].text;
+        write(next.data(), next.size());
+        waitingBytes -= next.size();
+        std::vector<char>().swap(next);
+      }
+      turn.notify_all();
+    }
+
+    // Bytes written, and whether all of them were.
+    uint64_t written() const { return bytes; }
+    bool ok() const { return !failed; }
+
+    // Most bytes of text waiting at the same time.
+    size_t peakWaitingBytes() const { return peakBytes; }
+
+  private:
+    struct Waiting {
+      std::vector<char> text;
+      bool done = false;
+    };
+
+    std::FILE* out;
+    size_t window;
+    std::mutex mutex;
+    std::condition_variable turn;
+    std::vector<Waiting> waiting;
+    size_t nextToWrite = 0, waitingBytes = 0, peakBytes = 0;
+    uint64_t bytes = 0;
+    bool failed = false;
+
+    void write(const char* text, size_t size) {
+      failed |= std::fwrite(text, 1, size, out) != size;
+      bytes += size;
+    }
+  };
+}  // namespace maze
+
+#endif
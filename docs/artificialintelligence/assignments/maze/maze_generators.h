@@ -0,0 +1,265 @@
+#ifndef MAZE_GENERATORS_H
+#define MAZE_GENERATORS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "maze_grid.h"
+#include "maze_render.h"
+
+namespace maze {
+  // backtracker: the original depth-first walk with the fixed table, see DepthFirstGenerator
+  // eller: one row at a time in memory proportional to the width, printed as it goes
+  // kruskal: every wall in a random order, removed when it parts two unconnected regions
+  // wilson: loop-erased random walks, every maze equally likely
+  // All of them carve perfect mazes: exactly one path between any two cells. The generators
+  // other than the backtracker draw from a SeededRandom, so a seed always gives the same maze.
+  inline bool isGenerator(const std::string& name) {
+    return name == "backtracker" || name == "eller" || name == "kruskal" || name == "wilson";
+  }
+
+  // splitmix64: fast, seeded with any integer, and the same sequence on every platform.
+  class SeededRandom {
+  public:
+    explicit SeededRandom(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+      uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+      return z ^ (z >> 31);
+    }
+
+    // A number in [0, count), by multiplication instead of a modulo.
+    uint32_t below(uint32_t count) { return uint32_t(((next() >> 32) * count) >> 32); }
+
+    // A fair coin, 64 flips per number drawn.
+    bool coin() {
+      if (bitsLeft == 0) {
+        bits = next();
+        bitsLeft = 64;
+      }
+      bitsLeft--;
+      bool heads = bits & 1;
+      bits >>= 1;
+      return heads;
+    }
+
+  private:
+    uint64_t state;
+    uint64_t bits = 0;
+    int bitsLeft = 0;
+  };
+
+  // Eller's algorithm. Only the current row is kept, with the set of cells every cell is
+  // connected to through the rows above: adjacent cells of different sets are joined at random,
+  // every set then goes down through at least one cell, and the cells below that were not
+  // reached start sets of their own. The last row joins all the sets left. Every row goes to
+  // the renderer as soon as the walls to the row below are known, so a maze of any height takes
+  // the same memory, a few words per column.
+  class EllerGenerator {
+  public:
+    void generate(int columns, int rows, SeededRandom& random, MazeRenderer& renderer) {
+      if (columns < 1 || rows < 1) return;
+      const size_t width = size_t(columns);
+      row.assign(width, MazeGrid::TopWall);
+      below.assign(width, 0);
+      setOf.resize(width);
+      parent.resize(width);
+      cellsLeft.resize(width);
+      goesDown.resize(width);
+      freeSets.resize(width + 1);
+      // sets are numbered by column, so there are always enough numbers for a row
+      for (size_t x = 0; x < width; x++) setOf[x] = uint32_t(x);
+      renderer.writeTop(row.data(), columns);
+
+      for (int y = 0; y < rows; y++) {
+        bool last = y + 1 == rows;
+        for (size_t x = 0; x < width; x++) parent[x] = uint32_t(x);
+
+        // joins to the right, never inside a set, which would close a loop; the coin flips are
+        // as likely one way as the other, so the loops below select instead of branching
+        row[0] |= MazeGrid::LeftWall;
+        uint32_t left = setOf[0];
+        for (size_t x = 1; x < width; x++) {
+          // the set on the left is still a root, only the right one can be joined to it
+          uint32_t right = find(setOf[x]);
+          bool join = (left != right) & (last | random.coin());
+          parent[right] = join ? left : right;
+          row[x] = uint8_t((row[x] & ~MazeGrid::LeftWall) | (join ? 0 : MazeGrid::LeftWall));
+          left = join ? left : right;
+        }
+        for (size_t x = 0; x < width; x++) setOf[x] = find(setOf[x]);
+        if (last) {
+          renderer.writeRow(row.data(), nullptr, columns);
+          break;
+        }
+
+        // every set goes down at random, and through its last cell if it has not yet
+        std::fill(cellsLeft.begin(), cellsLeft.end(), 0);
+        std::fill(goesDown.begin(), goesDown.end(), 0);
+        for (size_t x = 0; x < width; x++) cellsLeft[setOf[x]]++;
+        for (size_t x = 0; x < width; x++) {
+          uint32_t set = setOf[x];
+          bool lastOfSet = --cellsLeft[set] == 0;
+          bool down = random.coin() | (lastOfSet & !goesDown[set]);
+          goesDown[set] |= uint8_t(down);
+          below[x] = down ? 0 : MazeGrid::TopWall;
+        }
+        renderer.writeRow(row.data(), below.data(), columns);
+
+        // the cells below keep the set they came down from, the others get unused numbers;
+        // goesDown already marks the sets that went down, the first entry of freeSets is never
+        // handed out
+        size_t free = 1;
+        for (size_t set = 0; set < width; set++) {
+          freeSets[free] = uint32_t(set);
+          free += !goesDown[set];
+        }
+        for (size_t x = 0; x < width; x++) {
+          bool fresh = below[x] != 0;
+          setOf[x] = fresh ? freeSets[free - 1] : setOf[x];
+          free -= fresh;
+        }
+        std::swap(row, below);
+      }
+    }
+
+    size_t memoryBytes() const {
+      return row.capacity() + below.capacity() + goesDown.capacity()
+             + (setOf.capacity() + parent.capacity() + cellsLeft.capacity()
+                + freeSets.capacity())
+                   * sizeof(uint32_t);
+    }
+
+  private:
+    std::vector<uint8_t> row, below, goesDown;
+    std::vector<uint32_t> setOf, parent, cellsLeft, freeSets;
+
+    uint32_t find(uint32_t set) {
+      while (parent[set] != set) set = parent[set] = parent[parent[set]];
+      return set;
+    }
+  };
+
+  // Kruskal's algorithm: the walls between neighbours are shuffled, then every wall whose two
+  // cells are not yet connected is removed. The regions are kept in a union-find over the cells,
+  // with path halving and union by rank.
+  class KruskalGenerator {
+  public:
+    // wall numbers are cell * 2 for the right wall and cell * 2 + 1 for the bottom wall
+    static constexpr uint64_t maxCells = uint64_t(1) << 31;
+
+    void generate(MazeGrid& grid, SeededRandom& random) {
+      const uint32_t columns = uint32_t(grid.columns), rows = uint32_t(grid.rows);
+      const uint32_t cells = uint32_t(grid.size());
+      walls.clear();
+      walls.reserve(2 * size_t(cells));
+      for (uint32_t cell = 0; cell < cells; cell++) {
+        if (cell % columns + 1 < columns) walls.push_back(cell * 2);
+        if (cell / columns + 1 < rows) walls.push_back(cell * 2 + 1);
+      }
+      for (size_t i = walls.size(); i > 1; i--)
+        std::swap(walls[i - 1], walls[random.below(uint32_t(i))]);
+
+      parent.resize(cells);
+      for (uint32_t cell = 0; cell < cells; cell++) parent[cell] = cell;
+      rank.assign(cells, 0);
+      uint32_t regions = cells;
+      for (uint32_t wall : walls) {
+        uint32_t cell = wall / 2;
+        uint32_t other = wall & 1 ? cell + columns : cell + 1;
+        uint32_t a = find(cell), b = find(other);
+        if (a == b) continue;
+        if (rank[a] < rank[b]) std::swap(a, b);
+        parent[b] = a;
+        if (rank[a] == rank[b]) rank[a]++;
+        grid.cells[other] &= uint8_t(wall & 1 ? ~MazeGrid::TopWall : ~MazeGrid::LeftWall);
+        if (--regions == 1) break;
+      }
+    }
+
+    size_t memoryBytes() const {
+      return (walls.capacity() + parent.capacity()) * sizeof(uint32_t) + rank.capacity();
+    }
+
+  private:
+    std::vector<uint32_t> walls, parent;
+    std::vector<uint8_t> rank;
+
+    uint32_t find(uint32_t cell) {
+      while (parent[cell] != cell) cell = parent[cell] = parent[parent[cell]];
+      return cell;
+    }
+  };
+
+  // Wilson's algorithm: from every cell not in the maze yet, a random walk goes on until it
+  // reaches the maze, and the path it leaves, without its loops, is added to it. Every cell
+  // remembers in two spare bits the direction the walk last left it by, so going over a loop
+  // again overwrites it and following the directions from the start gives the loop-erased path
+  // with no memory besides the grid.
+  class WilsonGenerator {
+  public:
+    void generate(MazeGrid& grid, SeededRandom& random) {
+      const uint32_t columns = uint32_t(grid.columns), rows = uint32_t(grid.rows);
+      const size_t cells = grid.size();
+      uint8_t* cell = grid.cells.data();
+      cell[random.below(uint32_t(cells))] |= MazeGrid::Visited;
+
+      for (size_t start = 0; start < cells; start++) {
+        if (cell[start] & MazeGrid::Visited) continue;
+        size_t current = start;
+        while (!(cell[current] & MazeGrid::Visited)) {
+          uint32_t x = uint32_t(current % columns), y = uint32_t(current / columns);
+          uint8_t open[4];
+          uint32_t count = 0;
+          if (y > 0) open[count++] = Up;
+          if (x + 1 < columns) open[count++] = Right;
+          if (y + 1 < rows) open[count++] = Down;
+          if (x > 0) open[count++] = Left;
+          uint8_t direction = open[random.below(count)];
+          cell[current] = uint8_t((cell[current] & ~WalkMask) | (direction << WalkShift));
+          current = step(current, direction, columns);
+        }
+        // the loop-erased path, carved into the maze
+        for (current = start; !(cell[current] & MazeGrid::Visited);) {
+          uint8_t direction = uint8_t((cell[current] & WalkMask) >> WalkShift);
+          size_t next = step(current, direction, columns);
+          if (direction == Up || direction == Left)
+            cell[current] &= uint8_t(direction == Up ? ~MazeGrid::TopWall : ~MazeGrid::LeftWall);
+          else
+            cell[next] &= uint8_t(direction == Down ? ~MazeGrid::TopWall : ~MazeGrid::LeftWall);
+          cell[current] |= MazeGrid::Visited;
+          current = next;
+        }
+      }
+    }
+
+    size_t memoryBytes() const { return 0; }
+
+  private:
+    enum : uint8_t { Up, Right, Down, Left };
+    // bits of a cell holding the direction of the walk
+    static constexpr int WalkShift = 3;
+    static constexpr uint8_t WalkMask = 3 << WalkShift;
+
+    static size_t step(size_t cell, uint8_t direction, uint32_t columns) {
+      switch (direction) {
+        case Up:
+          return cell - columns;
+        case Right:
+          return cell + 1;
+        case Down:
+          return cell + columns;
+        default:
+          return cell - 1;
+      }
+    }
+  };
+}  // namespace maze
+
+#endif
@@ -0,0 +1,131 @@
+#ifndef MAZE_GRID_H
+#define MAZE_GRID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace maze {
+  // The fixed table of numbers the original generator draws its choices from, starting at the
+  // seed and wrapping around after the last entry.
+  class RandomTable {
+  public:
+    static constexpr int length = 100;
+
+    explicit RandomTable(int seed) : position(((seed % length) + length) % length) {}
+
+    // Which of `count` choices to take. A single choice takes no number from the table.
+    int next(int count) {
+      if (count == 1) return 0;
+      int choice = table[position] % count;
+      if (++position >= length) position = 0;
+      return choice;
+    }
+
+  private:
+    static constexpr int table[length] = {
+        72, 99, 56, 34, 43, 62, 31, 4,  70, 22, 6,  65, 96, 71, 29, 9,  98, 41, 90, 7,
+        30, 3,  97, 49, 63, 88, 47, 82, 91, 54, 74, 2,  86, 14, 58, 35, 89, 11, 10, 60,
+        28, 21, 52, 50, 55, 69, 76, 94, 23, 66, 15, 57, 44, 18, 67, 5,  24, 33, 77, 53,
+        51, 59, 20, 42, 80, 61, 1,  0,  38, 64, 45, 92, 46, 79, 93, 95, 37, 40, 83, 13,
+        12, 78, 75, 73, 84, 81, 8,  32, 27, 19, 87, 85, 16, 25, 17, 68, 26, 39, 48, 36};
+    int position;
+  };
+
+  // Maze as one array of cells in row order, a byte per cell: the wall on its left, the wall on
+  // its top and whether the generator has been there. The right wall of a cell is the left wall
+  // of the next one, and its bottom wall the top wall of the cell below; the outer walls on the
+  // right and at the bottom are always there. A solver can mark the cells of a path, which the
+  // renderer then draws, see maze_solver.h.
+  struct MazeGrid {
+    enum : uint8_t { Visited = 1, LeftWall = 2, TopWall = 4, OnPath = 32 };
+
+    int columns = 0, rows = 0;
+    std::vector<uint8_t> cells;
+
+    // every cell with both its walls and not visited yet
+    void reset(int newColumns, int newRows) {
+      columns = newColumns;
+      rows = newRows;
+      cells.assign(size(), LeftWall | TopWall);
+    }
+
+    size_t size() const { return size_t(columns) * size_t(rows); }
+    size_t index(int x, int y) const { return size_t(y) * size_t(columns) + size_t(x); }
+
+    bool leftWall(int x, int y) const { return cells[index(x, y)] & LeftWall; }
+    bool topWall(int x, int y) const { return cells[index(x, y)] & TopWall; }
+  };
+
+  // Recursive backtracker on a MazeGrid, without recursion: the path from the first cell is an
+  // explicit stack of cell indices, allocated once for the largest maze seen, and the unvisited
+  // neighbours of a cell go into a buffer of four. The neighbours are looked at up, right, down,
+  // left, and picked with the same table numbers as the original, so the maze is the same.
+  class DepthFirstGenerator {
+  public:
+    void generate(MazeGrid& grid, RandomTable& random) {
+      if (grid.size() == 0) return;
+      // the path can go through every cell
+      stack.reserve(grid.size());
+      stack.clear();
+      const uint32_t columns = uint32_t(grid.columns), rows = uint32_t(grid.rows);
+      uint8_t* cells = grid.cells.data();
+      cells[0] |= MazeGrid::Visited;
+      stack.push_back(0);
+
+      // the cell on top of the stack and its column and row, which only need a division when
+      // the path backs up
+      uint32_t cell = 0, x = 0, y = 0;
+      while (true) {
+        Direction open[4];
+        int count = 0;
+        if (y > 0 && !(cells[cell - columns] & MazeGrid::Visited)) open[count++] = Up;
+        if (x + 1 < columns && !(cells[cell + 1] & MazeGrid::Visited)) open[count++] = Right;
+        if (y + 1 < rows && !(cells[cell + columns] & MazeGrid::Visited)) open[count++] = Down;
+        if (x > 0 && !(cells[cell - 1] & MazeGrid::Visited)) open[count++] = Left;
+        if (count == 0) {
+          stack.pop_back();
+          if (stack.empty()) break;
+          cell = stack.back();
+          x = cell % columns;
+          y = cell / columns;
+          continue;
+        }
+
+        // a wall between two cells belongs to the one right of it or below it
+        switch (open[random.next(count)]) {
+          case Up:
+            cells[cell] &= uint8_t(~MazeGrid::TopWall);
+            cell -= columns;
+            y--;
+            break;
+          case Right:
+            cell++;
+            x++;
+            cells[cell] &= uint8_t(~MazeGrid::LeftWall);
+            break;
+          case Down:
+            cell += columns;
+            y++;
+            cells[cell] &= uint8_t(~MazeGrid::TopWall);
+            break;
+          default:
+            cells[cell] &= uint8_t(~MazeGrid::LeftWall);
+            cell--;
+            x--;
+            break;
+        }
+        cells[cell] |= MazeGrid::Visited;
+        stack.push_back(cell);
+      }
+    }
+
+    size_t memoryBytes() const { return stack.capacity() * sizeof(uint32_t); }
+
+  private:
+    enum Direction : uint8_t { Up, Right, Down, Left };
+    std::vector<uint32_t> stack;
+  };
+}  // namespace maze
+
+#endif
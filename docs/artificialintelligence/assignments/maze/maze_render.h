@@ -0,0 +1,111 @@
+#ifndef MAZE_RENDER_H
+#define MAZE_RENDER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "maze_grid.h"
+
+namespace maze {
+  // Text of a maze written through one reusable buffer: every line is built in the buffer with
+  // plain byte stores and the buffer goes out in a single fwrite once it holds a large block,
+  // so there is no formatting call per cell and no flush per line. The text is the one the
+  // original renderer prints: a line of " _" per column, then a line per row of the left wall
+  // and the bottom wall of every cell, closed by the outer right wall. The cells marked as on a
+  // path show '.' in place of an open bottom and '=' in place of a bottom wall. A renderer
+  // without a file keeps all the text in its buffer instead, until clear().
+  class MazeRenderer {
+  public:
+    explicit MazeRenderer(std::FILE* out = nullptr) : out(out) {}
+    MazeRenderer(const MazeRenderer&) = delete;
+    MazeRenderer& operator=(const MazeRenderer&) = delete;
+    ~MazeRenderer() { flush(); }
+
+    // The whole maze.
+    bool render(const MazeGrid& grid) {
+      writeTop(grid);
+      for (int y = 0; y < grid.rows; y++) writeRow(grid, y);
+      return flush();
+    }
+
+    // The line above the first row.
+    void writeTop(const MazeGrid& grid) { writeTop(grid.cells.data(), grid.columns); }
+
+    // The line of row y, which needs the top walls of row y + 1.
+    void writeRow(const MazeGrid& grid, int y) {
+      const uint8_t* row = grid.cells.data() + grid.index(0, y);
+      writeRow(row, y + 1 < grid.rows ? row + grid.columns : nullptr, grid.columns);
+    }
+
+    // The same lines from the cells of a row alone, for generators that never hold the whole
+    // maze: the line above `first`, the first row, and the line of `row`, with `below` the row
+    // under it or null for the last row.
+    void writeTop(const uint8_t* first, int columns) {
+      char* next = reserve(2 * size_t(columns) + 3);
+      for (int x = 0; x < columns; x++) {
+        if (!(first[x] & MazeGrid::TopWall)) continue;
+        *next++ = ' ';
+        *next++ = '_';
+      }
+      *next++ = ' ';
+      *next++ = ' ';
+      *next++ = '\n';
+      used = size_t(next - buffer.data());
+    }
+
+    void writeRow(const uint8_t* row, const uint8_t* below, int columns) {
+      static constexpr char floors[] = " _.=";
+      char* next = reserve(2 * size_t(columns) + 3);
+      for (int x = 0; x < columns; x++) {
+        *next++ = row[x] & MazeGrid::LeftWall ? '|' : ' ';
+        bool wall = !below || (below[x] & MazeGrid::TopWall);
+        *next++ = floors[int(wall) + (row[x] & MazeGrid::OnPath ? 2 : 0)];
+      }
+      *next++ = '|';
+      *next++ = ' ';
+      *next++ = '\n';
+      used = size_t(next - buffer.data());
+    }
+
+    // The text kept so far, when there is no file.
+    const char* text() const { return buffer.data(); }
+    size_t size() const { return used; }
+    void clear() { used = 0; }
+
+    size_t memoryBytes() const { return buffer.capacity(); }
+
+    // Writes out what the buffer holds. False once any write to the file failed, this one or an
+    // earlier one made when the buffer was full.
+    bool flush() {
+      if (!out) return true;
+      failed |= std::fwrite(buffer.data(), 1, used, out) != used;
+      used = 0;
+      failed |= std::fflush(out) != 0;
+      return !failed;
+    }
+
+  private:
+    static constexpr size_t blockSize = size_t(1) << 20;
+    std::FILE* out;
+    std::vector<char> buffer;
+    size_t used = 0;
+    bool failed = false;
+
+    // Room for `bytes` more bytes, writing out the buffer first when it holds a full block. With
+    // no file the buffer doubles instead.
+    char* reserve(size_t bytes) {
+      if (out && used + bytes > blockSize && used > 0) {
+        failed |= std::fwrite(buffer.data(), 1, used, out) != used;
+        used = 0;
+      }
+      if (buffer.size() < used + bytes)
+        buffer.resize(std::max(used + bytes, out ? blockSize : 2 * buffer.size()));
+      return buffer.data() + used;
+    }
+  };
+}  // namespace maze
+
+#endif
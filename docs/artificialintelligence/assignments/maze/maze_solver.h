@@ -0,0 +1,310 @@
+#ifndef MAZE_SOLVER_H
+#define MAZE_SOLVER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "maze_grid.h"
+
+namespace maze {
+  // bfs: breadth first from the start until the goal comes off the queue
+  // astar: best first on the moves so far plus the Manhattan distance left
+  // bidirectional: breadth first from both ends, a whole level at a time, until they meet
+  // All three find a shortest path; in a perfect maze there is only one anyway, and they differ
+  // in how many cells they look at before they find it.
+  enum class Search { Bfs, AStar, Bidirectional };
+
+  inline const char* searchName(Search search) {
+    switch (search) {
+      case Search::AStar:
+        return "astar";
+      case Search::Bidirectional:
+        return "bidirectional";
+      default:
+        return "bfs";
+    }
+  }
+
+  inline bool parseSearch(const std::string& name, Search& search) {
+    for (Search known : {Search::Bfs, Search::AStar, Search::Bidirectional}) {
+      if (name == searchName(known)) {
+        search = known;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // One bit per cell, in words of 64.
+  class CellBits {
+  public:
+    void reset(size_t cells) { words.assign((cells + 63) / 64, 0); }
+    bool test(uint32_t cell) const { return words[cell >> 6] >> (cell & 63) & 1; }
+    void set(uint32_t cell) { words[cell >> 6] |= uint64_t(1) << (cell & 63); }
+    size_t memoryBytes() const { return words.capacity() * sizeof(uint64_t); }
+
+  private:
+    std::vector<uint64_t> words;
+  };
+
+  // What one query found.
+  struct SolveResult {
+    bool found = false;
+    // moves from the start to the goal, cells on the path minus one
+    uint32_t length = 0;
+    // cells taken off the frontier and looked around from
+    size_t expanded = 0;
+  };
+
+  // Shortest paths between two cells of a MazeGrid, read straight off its walls. The cells seen
+  // are kept in bitsets and the way back from every cell in two bits of a byte per cell, both
+  // cleared per query only as far as the bitsets go; the queues and the heap are sized for the
+  // whole grid once and reused by every query on a grid of that size or smaller.
+  class MazeSolver {
+  public:
+    static constexpr uint32_t unreachable = UINT32_MAX;
+
+    SolveResult solve(const MazeGrid& grid, Search search, uint32_t from, uint32_t to) {
+      prepare(grid);
+      pathCells.clear();
+      switch (search) {
+        case Search::AStar:
+          return aStar(grid, from, to);
+        case Search::Bidirectional:
+          return bidirectional(grid, from, to);
+        default:
+          return breadthFirst(grid, from, to);
+      }
+    }
+
+    // The cells of the path the last solve() found, from its start to its goal.
+    const std::vector<uint32_t>& path() const { return pathCells; }
+
+    // Marks the cells of the last path with MazeGrid::OnPath, after clearing the mark everywhere.
+    void overlay(MazeGrid& grid) const {
+      for (uint8_t& cell : grid.cells) cell &= uint8_t(~MazeGrid::OnPath);
+      for (uint32_t cell : pathCells) grid.cells[cell] |= MazeGrid::OnPath;
+    }
+
+    // Moves from `from` to every cell, unreachable for the cells it cannot reach. Returns the
+    // cells expanded, which is every cell reachable.
+    size_t distances(const MazeGrid& grid, uint32_t from, std::vector<uint32_t>& field) {
+      prepare(grid);
+      field.assign(grid.size(), unreachable);
+      size_t head = 0, tail = 0;
+      queue[tail++] = from;
+      field[from] = 0;
+      while (head < tail) {
+        uint32_t cell = queue[head++];
+        uint32_t next[4];
+        int count = openNeighbours(grid, cell, next, nullptr);
+        for (int i = 0; i < count; i++) {
+          if (field[next[i]] != unreachable) continue;
+          field[next[i]] = field[cell] + 1;
+          queue[tail++] = next[i];
+        }
+      }
+      return head;
+    }
+
+    size_t memoryBytes() const {
+      return seen.memoryBytes() + seenBack.memoryBytes() + wayBack.capacity()
+             + (queue.capacity() + queueBack.capacity() + moves.capacity()
+                + pathCells.capacity())
+                   * sizeof(uint32_t)
+             + heap.capacity() * sizeof(uint64_t);
+    }
+
+  private:
+    // the direction a neighbour lies in, and the one back from it
+    enum : uint8_t { Up, Right, Down, Left };
+    static uint8_t opposite(uint8_t direction) { return uint8_t(direction ^ 2); }
+
+    uint32_t columns = 0;
+    size_t cells = 0;
+    CellBits seen, seenBack;
+    // bits 0-1: the way back towards the start, bits 2-3: the way back towards the goal
+    std::vector<uint8_t> wayBack;
+    std::vector<uint32_t> queue, queueBack, moves, pathCells;
+    // A* entries, the estimate in the high half and the cell in the low half
+    std::vector<uint64_t> heap;
+
+    void prepare(const MazeGrid& grid) {
+      columns = uint32_t(grid.columns);
+      cells = grid.size();
+      seen.reset(cells);
+      seenBack.reset(cells);
+      if (wayBack.size() < cells) {
+        wayBack.resize(cells);
+        queue.resize(cells);
+        queueBack.resize(cells);
+      }
+    }
+
+    // The neighbours of a cell with no wall in between, and in `directions` where they lie. The
+    // outer walls are always there, so the cells on the left and top edges have their left and
+    // top walls and only the bottom edge needs a bound.
+    int openNeighbours(const MazeGrid& grid, uint32_t cell, uint32_t* next, uint8_t* directions) const {
+      const uint8_t* c = grid.cells.data();
+      int count = 0;
+      auto add = [&](uint32_t neighbour, uint8_t direction) {
+        if (directions) directions[count] = direction;
+        next[count++] = neighbour;
+      };
+      if (!(c[cell] & MazeGrid::TopWall)) add(cell - columns, Up);
+      if (cell + 1 < cells && !(c[cell + 1] & MazeGrid::LeftWall)) add(cell + 1, Right);
+      if (cell + columns < cells && !(c[cell + columns] & MazeGrid::TopWall)) add(cell + columns, Down);
+      if (!(c[cell] & MazeGrid::LeftWall)) add(cell - 1, Left);
+      return count;
+    }
+
+    uint32_t step(uint32_t cell, uint8_t direction) const {
+      switch (direction) {
+        case Up:
+          return cell - columns;
+        case Right:
+          return cell + 1;
+        case Down:
+          return cell + columns;
+        default:
+          return cell - 1;
+      }
+    }
+
+    // Follows the way back in bits `shift` of wayBack from `cell` until `end`, appending the cells.
+    void walkBack(uint32_t cell, uint32_t end, int shift) {
+      pathCells.push_back(cell);
+      while (cell != end) {
+        cell = step(cell, uint8_t(wayBack[cell] >> shift & 3));
+        pathCells.push_back(cell);
+      }
+    }
+
+    SolveResult finish(SolveResult result, uint32_t from, uint32_t to) {
+      result.found = true;
+      walkBack(to, from, 0);
+      std::reverse(pathCells.begin(), pathCells.end());
+      result.length = uint32_t(pathCells.size() - 1);
+      return result;
+    }
+
+    SolveResult breadthFirst(const MazeGrid& grid, uint32_t from, uint32_t to) {
+      SolveResult result;
+      size_t head = 0, tail = 0;
+      queue[tail++] = from;
+      seen.set(from);
+      while (head < tail) {
+        uint32_t cell = queue[head++];
+        result.expanded++;
+        if (cell == to) return finish(result, from, to);
+        uint32_t next[4];
+        uint8_t directions[4];
+        int count = openNeighbours(grid, cell, next, directions);
+        for (int i = 0; i < count; i++) {
+          if (seen.test(next[i])) continue;
+          seen.set(next[i]);
+          wayBack[next[i]] = opposite(directions[i]);
+          queue[tail++] = next[i];
+        }
+      }
+      return result;
+    }
+
+    // The moves to a cell are only valid once it is seen. A cell can go on the heap again when
+    // a shorter way to it turns up, and the stale entry is skipped when it comes off.
+    SolveResult aStar(const MazeGrid& grid, uint32_t from, uint32_t to) {
+      SolveResult result;
+      if (moves.size() < cells) moves.resize(cells);
+      heap.clear();
+      heap.reserve(cells);
+      const int64_t goalX = to % columns, goalY = to / columns;
+      auto estimate = [&](uint32_t cell, uint32_t sofar) {
+        int64_t dx = int64_t(cell % columns) - goalX, dy = int64_t(cell / columns) - goalY;
+        uint64_t left = uint64_t((dx < 0 ? -dx : dx) + (dy < 0 ? -dy : dy));
+        return (uint64_t(sofar) + left) << 32 | cell;
+      };
+      const std::greater<uint64_t> later;
+      moves[from] = 0;
+      seen.set(from);
+      heap.push_back(estimate(from, 0));
+      while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        uint64_t entry = heap.back();
+        heap.pop_back();
+        uint32_t cell = uint32_t(entry);
+        if (seenBack.test(cell)) continue;
+        // seenBack holds the cells already expanded
+        seenBack.set(cell);
+        result.expanded++;
+        if (cell == to) return finish(result, from, to);
+        uint32_t next[4];
+        uint8_t directions[4];
+        int count = openNeighbours(grid, cell, next, directions);
+        for (int i = 0; i < count; i++) {
+          uint32_t neighbour = next[i];
+          if (seen.test(neighbour) && moves[neighbour] <= moves[cell] + 1) continue;
+          seen.set(neighbour);
+          moves[neighbour] = moves[cell] + 1;
+          wayBack[neighbour] = opposite(directions[i]);
+          heap.push_back(estimate(neighbour, moves[neighbour]));
+          std::push_heap(heap.begin(), heap.end(), later);
+        }
+      }
+      return result;
+    }
+
+    // Each side expands a whole level of its queue at a time, the smaller side first. The first
+    // cell one side finds that the other has already seen is on a shortest path: any shorter
+    // one would have met at a cell of an earlier level.
+    SolveResult bidirectional(const MazeGrid& grid, uint32_t from, uint32_t to) {
+      SolveResult result;
+      if (from == to) return finish(result, from, to);
+      size_t head = 0, tail = 0, headBack = 0, tailBack = 0;
+      queue[tail++] = from;
+      seen.set(from);
+      queueBack[tailBack++] = to;
+      seenBack.set(to);
+      while (head < tail && headBack < tailBack) {
+        bool forward = tail - head <= tailBack - headBack;
+        std::vector<uint32_t>& q = forward ? queue : queueBack;
+        CellBits& mine = forward ? seen : seenBack;
+        const CellBits& theirs = forward ? seenBack : seen;
+        size_t& first = forward ? head : headBack;
+        size_t& last = forward ? tail : tailBack;
+        const int shift = forward ? 0 : 2;
+        const uint8_t keep = uint8_t(forward ? 0xC : 0x3);
+        for (size_t end = last; first < end;) {
+          uint32_t cell = q[first++];
+          result.expanded++;
+          uint32_t next[4];
+          uint8_t directions[4];
+          int count = openNeighbours(grid, cell, next, directions);
+          for (int i = 0; i < count; i++) {
+            uint32_t neighbour = next[i];
+            if (mine.test(neighbour)) continue;
+            mine.set(neighbour);
+            wayBack[neighbour] = uint8_t((wayBack[neighbour] & keep) | opposite(directions[i]) << shift);
+            if (theirs.test(neighbour)) {
+              // the start side up to the meeting cell, then the goal side down from it
+              result.found = true;
+              walkBack(neighbour, from, 0);
+              std::reverse(pathCells.begin(), pathCells.end());
+              pathCells.pop_back();
+              walkBack(neighbour, to, 2);
+              result.length = uint32_t(pathCells.size() - 1);
+              return result;
+            }
+            q[last++] = neighbour;
+          }
+        }
+      }
+      return result;
+    }
+  };
+}  // namespace maze
+
+#endif
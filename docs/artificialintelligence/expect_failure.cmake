@@ -0,0 +1,11 @@
+# runs TEST_EXECUTABLE with TEST_ARGS on TEST_INPUT and fails unless it exits with an error,
+# see add_custom_failure_test
+separate_arguments(ARGS UNIX_COMMAND "${TEST_ARGS}")
+execute_process(COMMAND ${TEST_EXECUTABLE} ${ARGS}
+        INPUT_FILE ${TEST_INPUT}
+        OUTPUT_QUIET
+        RESULT_VARIABLE RESULT)
+if(RESULT EQUAL 0)
+    message(FATAL_ERROR "${TEST_EXECUTABLE} accepted ${TEST_INPUT}")
+endif()
+message(STATUS "Rejected as expected: ${TEST_INPUT}")